@@ -1,67 +1,627 @@
+#define _POSIX_C_SOURCE 200809L  // pwrite, fsync, ftruncate
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+#include "library.h"
 
 #define MAX_BOOKS 1000
 #define MAX_MEMBERS 500
-#define MAX_TITLE 100
-#define MAX_AUTHOR 50
-#define MAX_NAME 50
-#define MAX_ID 20
+#define MAX_HOLDS (MAX_BOOKS * 10)
+#define HOLD_WAIT_DAYS 60       // a waiting hold lapses after this long
+#define HOLD_PICKUP_DAYS 7      // a copy set aside for a holder is kept this long
+#define HOLD_WAITING 0
+#define HOLD_READY 1
+#define HOLD_FULFILLED 2
+#define HOLD_EXPIRED 3
+#define HOLD_CANCELLED 4
+#define BRANCHES_DIR "branches"    // one subdirectory of data files per branch
+#define MAX_BRANCHES 32
+#define MAX_BRANCH_NAME 32
+#define MAX_PATH 512
 #define FILENAME_BOOKS "books.dat"
 #define FILENAME_MEMBERS "members.dat"
 #define FILENAME_TRANSACTIONS "transactions.dat"
+#define FILENAME_HOLDS "holds.dat"
+#define FILENAME_JOURNAL "library.journal"
+#define FILENAME_FINES "fines.dat"
+#define FILENAME_OPEN_LOANS "openloans.dat"
+#define FILENAME_ISBN_FILTER "books.bloom"
+#define FILENAME_REPLICATION_LOG "replication.log"
+#define TRACE_MAGIC 0x45435254U     // "TRCE": circulation trace header
+#define TRACE_SNAPSHOT_SUFFIX ".start"  // data files as the trace began
+#define MAX_TRACE_PAYLOAD 512
+#define TRACE_SEARCH_BOOK 1
+#define TRACE_SEARCH_MEMBER 2
+#define TRACE_ADD_BOOK 3
+#define TRACE_UPDATE_BOOK 4
+#define TRACE_DELETE_BOOK 5
+#define TRACE_ADD_MEMBER 6
+#define TRACE_UPDATE_MEMBER 7
+#define TRACE_DELETE_MEMBER 8
+#define TRACE_ISSUE 9
+#define TRACE_RETURN 10
+#define TRACE_PLACE_HOLD 11
+#define TRACE_CANCEL_HOLD 12
+#define TRACE_FUZZY_SEARCH 13
+#define TRACE_QUERY 14
+#define TRACE_END 0xFF            // final state digests; written at exit
+#define SHIP_MAGIC 0x50494853U      // "SHIP": start of a replication log entry
+#define SHIP_RESET 0xFF             // entry table value: replica drops its state
+#define MAX_SHIP_PENDING (MAX_BOOKS * 10)
+#define REPLICA_POLL_MS 50
+#define REPLICATION_LOG_LIMIT (64L * 1024 * 1024)  // start a new log once past this size
+#define FINE_CENTS_PER_DAY 500      // $5 per day late fee
+#define INVALID_DAY INT_MIN         // parseDay result for a malformed date
+#define FILENAME_BOOKS_CRC "books.crc"
+#define FILENAME_MEMBERS_CRC "members.crc"
+#define FILENAME_TRANSACTIONS_CRC "transactions.crc"
+#define FILENAME_HOLDS_CRC "holds.crc"
+#define CRC_MAGIC 0x43524332U       // "2CRC": checksum sidecar header
+#define CRC_BLOCK_RECORDS 64        // records covered by one CRC32C
+#define MAX_CRC_BLOCKS ((MAX_BOOKS * 10) / CRC_BLOCK_RECORDS + 1)
+#define JOURNAL_MAGIC 0x4A524E4CU   // trailer marking a fully written journal
+#define OPEN_LOANS_MAGIC 0x4E45504FU    // "OPEN": open-loan sidecar header
+#define ISBN_FILTER_MAGIC 0x4D4F4C42U   // "BLOM": ISBN filter file header
+#define FINES_MAGIC 0x454E4946U         // "FINE": fines.dat header
+#define ISBN_FILTER_MAX_BLOCKS 64      // 64-byte filter blocks at most (power of two)
+#define ISBN_FILTER_BITS_PER_KEY 16    // filter bits per ISBN when sizing the filter
+#define ISBN_FILTER_WORDS 8            // 64-bit words per block
+#define TABLE_BOOKS 0
+#define TABLE_MEMBERS 1
+#define TABLE_TRANSACTIONS 2
+#define TABLE_HOLDS 3
+#define TABLE_COUNT 4
+#define CHECKPOINT_QUEUE_SIZE 4    // pending saves before saveData blocks
+#define REPORT_CACHE_SLOTS 16      // rendered reports kept for reuse
+#define PAGE_SIZE_DEFAULT 20       // rows per page in the table views
+#define MAX_PAGE_SIZE 100
+#define PAGE_BUFFER_SIZE (MAX_PAGE_SIZE * 256 + 1024)   // one formatted page
+#define FUZZY_MAX_PATTERN 64    // Myers kernel works on one 64-bit word
+#define FUZZY_GRAM 3            // n-gram length used for candidate pruning
+#define FUZZY_SHORT_GRAM 2      // used when trigrams cannot prune a short pattern
+#define FUZZY_BUCKETS 4096      // hashed n-gram buckets in the fuzzy index
+#define FUZZY_DEFAULT_TOP_K 10
+#define HISTORY_SLOTS 16384    // open-addressing slots per history index (power of two)
+#define HOLD_PAIR_SLOTS 32768  // open-addressing slots for (book, member) hold pairs (power of two, > MAX_HOLDS)
+#define POPULARITY_WINDOW_DAYS 30   // sliding window for "this month" reports
+#define SKETCH_COUNTERS 64          // Space-Saving counters per day and dimension
+#define MAX_PREDICATES 8
+#define QUERY_TABLE_BOOKS 1
+#define QUERY_TABLE_MEMBERS 2
+#define QUERY_TABLE_TRANSACTIONS 3
 
-// Structure definitions
+// Structure definitions (Book, Member and Transaction are in library.h)
 typedef struct {
-    int id;
-    char title[MAX_TITLE];
+    int hold_id;
+    int book_id;
+    int member_id;
+    char placed_date[11];
+    char expires_date[11];
+    int status;
+} Hold;
+
+// Persistence state of one data file: which records changed since the
+// last save, and how many records the file currently holds
+typedef struct {
+    const char* filename;
+    const char* checksum_filename;
+    void* records;
+    size_t record_size;
+    int capacity;
+    int* count;
+    int persisted;
+    unsigned char* dirty;
+    int* dirty_list;
+    int dirty_count;
+} TableFile;
+
+// Head of one member's or book's loan history: an intrusive list through
+// the transaction slots, oldest first
+typedef struct {
+    int key;        // member or book id, 0 for an empty slot
+    int head;
+    int tail;
+    int count;
+} HistoryList;
+
+// Header of one replication log entry: the after-image of record index of
+// a table (index -1 when only the count changed), followed by the record
+typedef struct {
+    uint32_t magic;
+    uint32_t table;
+    uint64_t sequence;
+    int64_t timestamp_us;   // primary's wall clock when shipped
+    int32_t index;
+    int32_t count;          // table's record count after the change
+} ShipHeader;
+
+// Start of a circulation trace: when recording began and a digest of each
+// table then, so a replay can tell it starts from the same state
+typedef struct {
+    uint32_t magic;
+    uint32_t record_size;
+    int64_t start_us;       // wall clock when recording began
+    uint32_t start_digest[TABLE_COUNT];
+} TraceHeader;
+
+// One traced operation, followed by length bytes of text fields stored
+// back to back with their terminators
+typedef struct {
+    int64_t offset_us;      // since the trace began
+    uint8_t op;
+    uint8_t status;         // LibraryStatus the operation ended with
+    uint16_t length;
+    int32_t id;             // book, member or transaction the operation names
+    int32_t args[2];        // search field or table; year and quantity; member of
+                            // an issue or hold; typos and result cap of a fuzzy search
+    int32_t result;         // new id, match count or fine in cents
+} TraceRecord;
+
+// Holds on one book: a FIFO of waiting holds and a list of holds with a
+// copy set aside, both doubly linked through hold slots
+typedef struct {
+    int key;        // book id, 0 for an empty slot
+    int head;
+    int tail;
+    int waiting;
+    int ready_head;
+    int ready;
+} HoldQueue;
+
+// Number of active holds one member has on one book. Entries are never
+// removed, so a pair whose holds all ended keeps its slot with active 0;
+// there are at most as many pairs as hold records.
+typedef struct {
+    int book_id;    // 0 for an empty slot
+    int member_id;
+    int active;
+} HoldPair;
+
+// Entry of the hold expiry heap; stale once the hold's expiry or status
+// has moved on
+typedef struct {
+    int day;
+    int slot;
+} HoldDeadline;
+
+// A Space-Saving counter: count over-estimates the true frequency by at
+// most error
+typedef struct {
+    uint32_t key;
+    int count;
+    int error;
+    char label[MAX_TITLE];
+} HeavyHitter;
+
+// Heavy-hitter summary for the loans issued on one day
+typedef struct {
+    int day;
+    int size;
+    HeavyHitter counters[SKETCH_COUNTERS];
+} DaySketch;
+
+// Exact lifetime loan count for one author
+typedef struct {
+    uint32_t key;   // hash of the folded author name, 0 for an empty slot
+    int count;
     char author[MAX_AUTHOR];
-    char ISBN[14];
-    int year;
-    int quantity;
-    int available;
-    char category[30];
-} Book;
+} AuthorCount;
+
+// One persisted member balance in fines.dat
+typedef struct {
+    int member_id;
+    int cents;
+} FineBalance;
+
+// Header of fines.dat; followed by count FineBalance entries holding the
+// late fees charged at return
+typedef struct {
+    uint32_t magic;
+    int32_t as_of;
+    int32_t count;
+} FinesHeader;
 
+// A member's fines: late fees charged when loans came back, and what the
+// member's open loans had accrued as of fines_as_of
+typedef struct {
+    int member_id;      // 0 for an empty slot
+    int settled_cents;
+    int accrued_cents;
+} MemberFines;
+
+// Header of a checksum sidecar; followed by one CRC32C per block of
+// CRC_BLOCK_RECORDS records of the data file
+typedef struct {
+    uint32_t magic;
+    uint32_t record_size;
+    uint32_t record_count;
+    uint32_t block_records;
+} ChecksumHeader;
+
+// Outcome of loading one table on a loader thread
+typedef struct {
+    TableFile* table;
+    int generated;
+    char error[200];
+} LoadResult;
+
+// Header of openloans.dat; followed by the slots of the loans that were
+// open when transactions.dat last held transaction_count records
+typedef struct {
+    uint32_t magic;
+    int32_t transaction_count;
+    int32_t open_count;
+} OpenLoansHeader;
+
+// Header of books.bloom. books_digest is the CRC32C of books.crc when the
+// filter was written, so a filter left behind by an interrupted save is
+// never trusted.
+typedef struct {
+    uint32_t magic;
+    uint32_t blocks;
+    uint32_t books_digest;
+    uint32_t filter_crc;
+} IsbnFilterHeader;
+
+// A snapshot of dirty records, serialized in journal layout, waiting for
+// the background writer. open_slots is the open-loan set to record once
+// the snapshot is applied, or NULL when transactions did not change;
+// isbn_filter (of isbn_filter_blocks blocks) likewise for books.
+typedef struct {
+    char* buffer;
+    long size;
+    int sequence;
+    int* open_slots;
+    int open_count;
+    int transaction_count;
+    uint64_t* isbn_filter;
+    int isbn_filter_blocks;
+} Checkpoint;
+
+// Query engine: a query is a conjunction of predicates over one table
+typedef enum { FIELD_INT, FIELD_STR } FieldType;
+typedef enum { OP_EQ, OP_NE, OP_LT, OP_LE, OP_GT, OP_GE, OP_CONTAINS } PredicateOp;
+
+typedef struct {
+    const char* name;
+    FieldType type;
+    size_t offset;
+} FieldDef;
+
+typedef struct {
+    const FieldDef* field;
+    PredicateOp op;
+    char value[100];
+    int int_value;
+} Predicate;
+
+typedef struct {
+    int table;
+    Predicate predicates[MAX_PREDICATES];
+    int predicate_count;
+    int limit;
+    int offset;
+} Query;
+
+// One rendered report: its text is valid while the tables it reads are
+// still at the versions it was rendered from
+typedef struct {
+    int report;             // generateReports choice, 0 for an empty slot
+    char params[32];
+    unsigned int versions[TABLE_COUNT];
+    char* text;
+    size_t length;
+} ReportCacheEntry;
+
+// An id to resolve in a batch, and its position in the batch
 typedef struct {
     int id;
-    char name[MAX_NAME];
-    char membership_id[MAX_ID];
-    char email[50];
-    char phone[15];
-    int books_issued;
-    char join_date[11];
-} Member;
+    int position;
+} IdPosition;
 
+// Work item and result of scanning one branch on a fan-out thread
 typedef struct {
-    int transaction_id;
-    int book_id;
-    int member_id;
-    char issue_date[11];
-    char due_date[11];
-    char return_date[11];
-    int returned;
-} Transaction;
+    char name[MAX_BRANCH_NAME];
+    char path[MAX_PATH];
+    int local;              // this process's branch: scan memory, not files
+    Query* query;           // books filter, or NULL for totals only
+    Book* matches;
+    int match_count;
+    int books;
+    int copies;
+    int available;
+    int members;
+    int open_loans;
+    char error[200];
+} BranchScan;
 
 // Global arrays
 Book books[MAX_BOOKS];
 Member members[MAX_MEMBERS];
 Transaction transactions[MAX_BOOKS * 10]; // Assuming multiple transactions per book
+Hold holds[MAX_HOLDS];
 
 int book_count = 0;
 int member_count = 0;
 int transaction_count = 0;
+int hold_count = 0;
+
+// Branch this process serves; empty when running on the current directory
+char branch_name[MAX_BRANCH_NAME] = "";
+char branch_root[MAX_BRANCH_NAME] = BRANCHES_DIR;
+
+// Dirty-record tracking for incremental saves
+unsigned char book_dirty[MAX_BOOKS];
+unsigned char member_dirty[MAX_MEMBERS];
+unsigned char transaction_dirty[MAX_BOOKS * 10];
+int book_dirty_list[MAX_BOOKS];
+int member_dirty_list[MAX_MEMBERS];
+int transaction_dirty_list[MAX_BOOKS * 10];
+unsigned char hold_dirty[MAX_HOLDS];
+int hold_dirty_list[MAX_HOLDS];
+
+TableFile table_files[TABLE_COUNT] = {
+    {FILENAME_BOOKS, FILENAME_BOOKS_CRC, books, sizeof(Book), MAX_BOOKS,
+     &book_count, 0, book_dirty, book_dirty_list, 0},
+    {FILENAME_MEMBERS, FILENAME_MEMBERS_CRC, members, sizeof(Member), MAX_MEMBERS,
+     &member_count, 0, member_dirty, member_dirty_list, 0},
+    {FILENAME_TRANSACTIONS, FILENAME_TRANSACTIONS_CRC, transactions, sizeof(Transaction), MAX_BOOKS * 10,
+     &transaction_count, 0, transaction_dirty, transaction_dirty_list, 0},
+    {FILENAME_HOLDS, FILENAME_HOLDS_CRC, holds, sizeof(Hold), MAX_HOLDS,
+     &hold_count, 0, hold_dirty, hold_dirty_list, 0}
+};
+
+// Report cache. Each table's version is bumped by every change reported
+// through markDirty (and by the replica as it applies shipped records).
+unsigned int table_versions[TABLE_COUNT];
+ReportCacheEntry report_cache[REPORT_CACHE_SLOTS];
+int report_cache_next = 0;
+long report_cache_hits = 0;
+long report_cache_misses = 0;
+
+// Tables read by each cached report, indexed by generateReports choice
+const int report_tables[] = {
+    0,
+    1 << TABLE_BOOKS,                               // 1. books available
+    (1 << TABLE_BOOKS) | (1 << TABLE_TRANSACTIONS), // 2. books issued
+    (1 << TABLE_BOOKS) | (1 << TABLE_TRANSACTIONS), // 3. overdue books
+    1 << TABLE_MEMBERS,                             // 4. member report
+    1 << TABLE_BOOKS                                // 5. category-wise
+};
+
+// Log shipping. The primary ships the records each command touched once the
+// command finishes; a replica process tails the log and applies it in order.
+int replica_mode = 0;
+int ship_requested = 0;
+int ship_fd = -1;
+uint64_t ship_sequence = 0;
+int ship_pending_table[MAX_SHIP_PENDING];
+int ship_pending_index[MAX_SHIP_PENDING];
+int ship_pending_count = 0;
+int ship_overflow = 0;
+int ship_shipped_count[TABLE_COUNT];
+long ship_log_size = 0;
+long ship_snapshot_size = 0;
+pthread_mutex_t replica_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_t replica_thread;
+uint64_t replica_applied_sequence = 0;
+int64_t replica_last_lag_us = 0;
+int replica_indexed_transactions = 0;
+long replica_bytes_behind = 0;
+
+// Circulation trace (--trace) and its replay (--replay). While replaying,
+// dates follow the recorded clock so due dates and fines come out the same.
+FILE* trace_file = NULL;
+int64_t trace_start_us = 0;
+int64_t trace_start_mono_us = 0;
+time_t clock_override = 0;
+const char* trace_snapshot_files[] = {
+    FILENAME_BOOKS, FILENAME_MEMBERS, FILENAME_TRANSACTIONS, FILENAME_HOLDS,
+    FILENAME_BOOKS_CRC, FILENAME_MEMBERS_CRC, FILENAME_TRANSACTIONS_CRC, FILENAME_HOLDS_CRC,
+    FILENAME_JOURNAL, FILENAME_FINES, FILENAME_OPEN_LOANS, FILENAME_ISBN_FILTER
+};
+const char* trace_op_names[] = {
+    "", "search book", "search member", "add book", "update book", "delete book",
+    "add member", "update member", "delete member", "issue", "return",
+    "place hold", "cancel hold", "fuzzy search", "query"
+};
+
+// Hold queues per book, active holds per (book, member), the queues' list
+// links, each active hold's expiry day, and a min-heap of expiry days
+// driving the sweep
+HoldQueue hold_queues[HISTORY_SLOTS];
+HoldPair hold_pairs[HOLD_PAIR_SLOTS];
+int hold_next[MAX_HOLDS];
+int hold_prev[MAX_HOLDS];
+int hold_expire_day[MAX_HOLDS];
+HoldDeadline hold_heap[MAX_HOLDS * 2];
+int hold_heap_size = 0;
+
+// Background checkpoint writer: saveData snapshots dirty records on the
+// interactive thread and hands them to a single writer thread in order
+Checkpoint checkpoint_queue[CHECKPOINT_QUEUE_SIZE];
+int checkpoint_head = 0;
+int checkpoint_tail = 0;
+int checkpoint_pending = 0;
+int checkpoint_sequence = 0;
+int checkpoint_completed = 0;
+int checkpoint_reported = 0;
+int checkpoint_failed = 0;
+int checkpoint_failures = 0;    // failed saves so far; saveData never clears it
+int checkpoint_stopping = 0;
+int checkpoint_running = 0;
+pthread_t checkpoint_thread;
+pthread_mutex_t checkpoint_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t checkpoint_not_empty = PTHREAD_COND_INITIALIZER;
+pthread_cond_t checkpoint_not_full = PTHREAD_COND_INITIALIZER;
+pthread_cond_t checkpoint_done = PTHREAD_COND_INITIALIZER;
+
+// Open loans as ascending transaction slots: the working set loaded at
+// startup. The rest of transactions.dat is paged in by checksum block the
+// first time a history view needs it; until then history_loaded is 0 and
+// the history, issue-date and popularity indexes are not built.
+int open_loans[MAX_BOOKS * 10];
+int open_loan_count = 0;
+int history_loaded = 0;
+int history_file_count = 0;
+unsigned char history_block_loaded[MAX_CRC_BLOCKS];
+
+// Per-member and per-book loan histories; transactions are never removed,
+// so their slots are stable list nodes
+HistoryList member_history[HISTORY_SLOTS];
+HistoryList book_history[HISTORY_SLOTS];
+int member_history_next[MAX_BOOKS * 10];
+int book_history_next[MAX_BOOKS * 10];
+
+// Fines per member, open-addressed by member id. Kept apart from
+// member_history so the balances survive the history being paged in.
+MemberFines member_fines[HISTORY_SLOTS];
+int fines_as_of = -1;
+int fines_unsaved = 0;
+
+// Popularity counters: exact lifetime counts per book come from
+// book_history; per author they live in author_loans. The sliding window
+// keeps one bounded sketch per day in a ring indexed by day number.
+AuthorCount author_loans[HISTORY_SLOTS];
+DaySketch title_window[POPULARITY_WINDOW_DAYS];
+DaySketch author_window[POPULARITY_WINDOW_DAYS];
+
+// Transaction slots ordered by issue date (ties in slot order), with each
+// slot's issue date pre-parsed to a day number for cheap comparisons
+int issue_order[MAX_BOOKS * 10];
+int issue_day[MAX_BOOKS * 10];
+
+// Case-folded copies of title/author, kept in step with books[] so fuzzy
+// search never has to lowercase a record during comparison
+char book_title_fold[MAX_BOOKS][MAX_TITLE];
+char book_author_fold[MAX_BOOKS][MAX_AUTHOR];
+
+// Hashed n-gram index over the folded fields (CSR layout: postings of
+// bucket b live in fuzzy_postings[fuzzy_bucket_start[b] .. [b+1]]), and
+// the same over bigrams for patterns too short for trigrams to prune
+int fuzzy_bucket_start[FUZZY_BUCKETS + 1];
+int fuzzy_postings[MAX_BOOKS * (MAX_TITLE + MAX_AUTHOR)];
+int fuzzy_bigram_start[FUZZY_BUCKETS + 1];
+int fuzzy_bigram_postings[MAX_BOOKS * (MAX_TITLE + MAX_AUTHOR)];
+int fuzzy_index_dirty = 1;
+
+// Blocked Bloom filter over the valid ISBNs in books[]: a key sets one bit
+// in each word of a single 64-byte block, so a negative lookup touches one
+// cache line. Only the first isbn_filter_blocks blocks are in use; the
+// count is sized from book_count on every rebuild. Deletions, and adds
+// that outgrow the size, rebuild it.
+_Alignas(64) uint64_t isbn_filter[ISBN_FILTER_MAX_BLOCKS][ISBN_FILTER_WORDS];
+int isbn_filter_blocks = 1;
+int isbn_filter_unsaved = 0;
+
+// Queryable fields per table
+const FieldDef book_fields[] = {
+    {"id", FIELD_INT, offsetof(Book, id)},
+    {"title", FIELD_STR, offsetof(Book, title)},
+    {"author", FIELD_STR, offsetof(Book, author)},
+    {"isbn", FIELD_STR, offsetof(Book, ISBN)},
+    {"year", FIELD_INT, offsetof(Book, year)},
+    {"quantity", FIELD_INT, offsetof(Book, quantity)},
+    {"available", FIELD_INT, offsetof(Book, available)},
+    {"category", FIELD_STR, offsetof(Book, category)},
+    {NULL, FIELD_INT, 0}
+};
+
+const FieldDef member_fields[] = {
+    {"id", FIELD_INT, offsetof(Member, id)},
+    {"name", FIELD_STR, offsetof(Member, name)},
+    {"membership_id", FIELD_STR, offsetof(Member, membership_id)},
+    {"email", FIELD_STR, offsetof(Member, email)},
+    {"phone", FIELD_STR, offsetof(Member, phone)},
+    {"books_issued", FIELD_INT, offsetof(Member, books_issued)},
+    {"join_date", FIELD_STR, offsetof(Member, join_date)},
+    {NULL, FIELD_INT, 0}
+};
+
+const FieldDef transaction_fields[] = {
+    {"transaction_id", FIELD_INT, offsetof(Transaction, transaction_id)},
+    {"book_id", FIELD_INT, offsetof(Transaction, book_id)},
+    {"member_id", FIELD_INT, offsetof(Transaction, member_id)},
+    {"issue_date", FIELD_STR, offsetof(Transaction, issue_date)},
+    {"due_date", FIELD_STR, offsetof(Transaction, due_date)},
+    {"return_date", FIELD_STR, offsetof(Transaction, return_date)},
+    {"returned", FIELD_INT, offsetof(Transaction, returned)},
+    {NULL, FIELD_INT, 0}
+};
 
 // Function prototypes
-void loadData();
-void saveData();
+int loadData(char* message, int message_size);
+int saveData();
+void markDirty(int table, int index);
+void markDirtyFrom(int table, int index);
+int replayJournal();
+int syncDirectory();
+void startShipping();
+void shipPendingMutations();
+void shipTable(char** buffer, long* size, long* capacity, int table, int index);
+void* replicaTailer(void* arg);
+long applyShipped(const char* buffer, long size);
+int64_t wallClockMicros();
+int isReadOnlyChoice(int choice);
+int64_t monotonicMicros();
+int startTrace(const char* path);
+void finishTrace();
+void traceOperation(int op, LibraryStatus status, int id, int arg0, int arg1, int result,
+                    const char** texts, int text_count);
+void traceBookInput(int op, LibraryStatus status, int id, const BookInput* input, int result);
+void traceMemberInput(int op, LibraryStatus status, int id, const MemberInput* input, int result);
+void stateDigest(uint32_t* digest);
+int copyFile(const char* source, const char* dest);
+int replayTrace(const char* path, double speed);
+int replayOperation(const TraceRecord* record, const char* payload, int* result);
+const char* nextTraceText(const char** cursor, const char* end);
+int compareLatency(const void* a, const void* b);
+int applyJournal(const char* buffer, long size);
+void* loadTable(void* arg);
+int readVerifiedTable(const char* path, const char* checksum_path, size_t record_size, int capacity,
+                      void* data, int* count, int* unverified, char* error, size_t error_size);
+int loadOpenLoans(LoadResult* result);
+int ensureHistoryLoaded();
+int loadHistoryBlocks(int first_block, int end_block);
+void setLoanOpen(int slot, int open);
+int writeOpenLoans(const int* slots, int count, int transaction_count);
+int writeChecksumFile(TableFile* tf);
+int updateChecksums(int data_fd, TableFile* tf, int count, const unsigned char* touched);
+uint32_t crc32c(uint32_t crc, const void* data, size_t length);
+int writeCheckpoint(Checkpoint* checkpoint);
+void* checkpointWriter(void* arg);
+void startCheckpointWriter();
+void stopCheckpointWriter();
 void displayMenu();
 void addBook();
 void viewBooks();
 void searchBook();
+void crossBranchSearch();
+void crossBranchSummary();
+int scanBranches(Query* query, BranchScan* scans);
+void* scanBranch(void* arg);
+int readBranchTable(BranchScan* scan, const char* filename, const char* checksum_filename,
+                    size_t record_size, int capacity, void* records, int* count);
+int selectBranch(const char* name);
+void fuzzySearchBooks();
+int fuzzyMatchBooks(const char* term, int max_distance, int top_k, int* best_index, int* best_distance);
 void updateBook();
 void deleteBook();
 void addMember();
@@ -71,22 +631,165 @@ void updateMember();
 void deleteMember();
 void issueBook();
 void returnBook();
+LibraryStatus addBookRecord(const BookInput* input, int* book_id);
+LibraryStatus updateBookRecord(int index, const BookInput* input);
+LibraryStatus deleteBookRecord(int index);
+LibraryStatus addMemberRecord(const MemberInput* input, int* member_id);
+LibraryStatus updateMemberRecord(int index, const MemberInput* input);
+LibraryStatus deleteMemberRecord(int index);
+LibraryStatus issueLoan(int book_index, int member_index, int* transaction_id);
+LibraryStatus returnLoan(int slot, int book_index, int member_index, int* fine_cents, int* hold_slot);
+LibraryStatus commitChanges();
+int findOpenLoan(int transaction_id);
+int bookMatchesField(int field, const Book* book, const char* term);
+int memberMatchesField(int field, const Member* member, const char* term);
+void resolveIds(const int* ids, int count, const void* records, size_t record_size, int record_count, int* indexes);
+int compareIdPosition(const void* a, const void* b);
+void copyText(char* dest, const char* source, size_t size);
 void viewTransactions();
+void browseTable(int table, char* title, const char* empty_message);
+int findIdPosition(int table, int id);
+int parseNumber(const char* text, int* value);
 void generateReports();
+void showCachedReport(int report);
+void writeTableReport(int report, FILE* out);
+ReportCacheEntry* findCachedReport(int report, const char* params);
+ReportCacheEntry* storeCachedReport(int report, const char* params, char* text, size_t length);
+void viewLoanHistory();
+void manageHolds();
+void placeHold(int book_index, int member_id);
+LibraryStatus placeHoldRecord(int book_index, int member_id, int* hold_id);
+LibraryStatus cancelHoldRecord(int hold_id);
+HoldQueue* findHoldQueue(int book_id, int create);
+HoldPair* findHoldPair(int book_id, int member_id, int create);
+void linkHold(int slot);
+void unlinkHold(int slot);
+int handOffCopies(int book_index);
+void sweepExpiredHolds();
+int findReadyHold(int book_id, int member_id);
+void pushHoldDeadline(int slot);
+void rebuildHoldQueues();
+int currentDay();
+HistoryList* findHistory(HistoryList* index, int key, int create);
+void indexTransaction(int slot);
+void rebuildLoanHistory();
+void accrueFines();
+void popularityReport();
+void recordLoan(int slot);
+void countAuthorLoan(Book* book);
+void rebuildPopularity();
+void sketchAdd(DaySketch* window, int day, uint32_t key, const char* label, int match_label);
+uint32_t authorKey(const char* author);
+int compareAuthors(const char* a, const char* b);
+void membersOwingReport();
+MemberFines* findMemberFines(int member_id, int create);
+int accruedFine(int slot, int day);
+void accrueOpenLoans(int day);
+void chargeReturnFine(int slot, int fine_cents);
+void loadFines();
+int saveFines();
+void circulationReport(int mode);
+void printCirculationRow(int mode, int group, int loans, int returned);
+void indexIssueDate(int slot);
+void rebuildIssueDateIndex();
+int findFirstIssuedOnOrAfter(int day);
+int parseDay(const char* date);
+void formatDay(int day, char* date);
+void queryRecords();
+int parseQuery(char* text, Query* query);
+int runQuery(Query* query, FILE* out, int* scanned);
+int planQuery(Query* query, int* candidates);
+int matchRecord(const void* record, Query* query);
+void printBookHeader(FILE* out);
+void printBookRow(FILE* out, Book* book);
+void printMemberHeader(FILE* out);
+void printMemberRow(FILE* out, Member* member);
+void printTransactionHeader(FILE* out);
+void printTransactionRow(FILE* out, Transaction* transaction);
 void getCurrentDate(char* date);
 void addDays(char* source, char* dest, int days);
 int dateDifference(char* date1, char* date2);
 int findBookById(int id);
-int findBookByISBN(char* isbn);
+int findBookByISBN(const char* isbn);
 int findMemberById(int id);
 int findMemberByMembershipId(char* membership_id);
-int isISBNValid(char* isbn);
+int isISBNValid(const char* isbn);
 void clearInputBuffer();
+char* promptLine(char* buffer, int size);
+int promptNumber(int* value);
 void printHeader(char* title);
+void foldBookRecord(int index);
+void rebuildFuzzyIndex();
+uint64_t isbnHash(const char* isbn);
+void isbnFilterAdd(const char* isbn);
+int isbnFilterMayContain(const char* isbn);
+int isbnFilterBlocksFor(int keys);
+void rebuildIsbnFilter();
+int loadIsbnFilter();
+int writeIsbnFilter(const uint64_t* filter, int blocks);
+int checksumFileDigest(const char* path, uint32_t* digest);
+void forEachGramBucket(const char* text, int q, int record, int* last_seen, int* out, int* fill);
+void buildGramIndex(int q, int* bucket_start, int* postings);
+int fuzzyDistance(const uint64_t* peq, int m, const char* text);
 
-// Main function
-int main() {
-    loadData();
+// Main function; left out when the core is built as a library
+#ifndef LIBRARY_NO_MAIN
+int main(int argc, char* argv[]) {
+    // --branch NAME serves one branch's shard under branches/NAME;
+    // --trace FILE records the session, --replay FILE re-runs a recording
+    const char* trace_path = NULL;
+    const char* replay_path = NULL;
+    double speed = 1;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--branch") == 0 && i + 1 < argc) {
+            if(!selectBranch(argv[++i])) {
+                return 1;
+            }
+        } else if(strcmp(argv[i], "--replica") == 0) {
+            // Read-only copy fed by the primary's replication log
+            replica_mode = 1;
+        } else if(strcmp(argv[i], "--ship") == 0) {
+            // Keep a replication log for --replica processes
+            ship_requested = 1;
+        } else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if(strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            // Replay pacing: 1 and 10 scale the recorded gaps, max drops them
+            i++;
+            speed = strcmp(argv[i], "max") == 0 ? 0 : atof(argv[i]);
+        }
+    }
+    
+    if(replay_path != NULL) {
+        return replayTrace(replay_path, speed);
+    }
+    
+    if(replica_mode) {
+        history_loaded = 1;     // every shipped transaction is indexed on arrival
+        if(pthread_create(&replica_thread, NULL, replicaTailer, NULL) != 0) {
+            fprintf(stderr, "Cannot start replica thread!\n");
+            return 1;
+        }
+    } else {
+        char message[1024];
+        int loaded = loadData(message, sizeof(message));
+        fputs(message, loaded ? stdout : stderr);
+        if(!loaded) {
+            fprintf(stderr, "Refusing to start on damaged data. Restore the file from a backup, "
+                            "or delete its .crc file to accept it as-is.\n");
+            return 1;
+        }
+        // The snapshot is taken before the writer can touch the files
+        if(trace_path != NULL && !startTrace(trace_path)) {
+            return 1;
+        }
+        startCheckpointWriter();
+        if(ship_requested) {
+            startShipping();
+        }
+    }
     
     int choice;
     
@@ -96,6 +799,19 @@ int main() {
         scanf("%d", &choice);
         clearInputBuffer();
         
+        if(replica_mode && !isReadOnlyChoice(choice)) {
+            if(choice == 0) {
+                break;
+            }
+            printf("This is a read-only replica. Make changes on the primary.\n");
+            printf("\nPress Enter to continue...");
+            getchar();
+            continue;
+        }
+        
+        // The replica applies shipped changes between commands, and while
+        // a read-only command waits in promptLine() or promptNumber()
+        pthread_mutex_lock(&replica_lock);
         switch(choice) {
             case 1: addBook(); break;
             case 2: viewBooks(); break;
@@ -112,16 +828,35 @@ int main() {
             case 13: viewTransactions(); break;
             case 14: generateReports(); break;
             case 15: 
-                saveData();
-                printf("Data saved successfully!\n");
+                if(saveData()) {
+                    printf("Save #%d queued; it completes in the background.\n", checkpoint_sequence);
+                } else {
+                    printf("Error: out of memory while saving!\n");
+                }
                 break;
+            case 16: queryRecords(); break;
+            case 17: viewLoanHistory(); break;
+            case 18: manageHolds(); break;
             case 0:
-                saveData();
+                finishTrace();
+                if(!saveData()) {
+                    printf("Error: out of memory while saving!\n");
+                }
+                stopCheckpointWriter();
+                if(checkpoint_failed) {
+                    printf("Warning: the last save failed! Check disk space and permissions.\n");
+                }
                 printf("Thank you for using Library Management System!\n");
                 break;
             default:
                 printf("Invalid choice! Please try again.\n");
         }
+        pthread_mutex_unlock(&replica_lock);
+        
+        // Ship what this command changed, in one append
+        if(!replica_mode) {
+            shipPendingMutations();
+        }
         
         if(choice != 0) {
             printf("\nPress Enter to continue...");
@@ -132,11 +867,22 @@ int main() {
     
     return 0;
 }
+#endif
 
 // Function to display main menu
 void displayMenu() {
     system("clear || cls");
     printHeader("LIBRARY MANAGEMENT SYSTEM");
+    if(branch_name[0]) {
+        printf("Branch: %s\n", branch_name);
+    }
+    if(replica_mode) {
+        pthread_mutex_lock(&replica_lock);
+        printf("READ-ONLY REPLICA: applied #%llu, lag %.1f ms, %ld bytes pending\n",
+               (unsigned long long)replica_applied_sequence,
+               replica_last_lag_us / 1000.0, replica_bytes_behind);
+        pthread_mutex_unlock(&replica_lock);
+    }
     printf("1.  Add New Book\n");
     printf("2.  View All Books\n");
     printf("3.  Search Book\n");
@@ -152,828 +898,4957 @@ void displayMenu() {
     printf("13. View Transactions\n");
     printf("14. Generate Reports\n");
     printf("15. Save Data\n");
+    printf("16. Query Records\n");
+    printf("17. Loan History\n");
+    printf("18. Holds / Reservations\n");
     printf("0.  Exit\n");
     printf("====================================\n");
+    
+    pthread_mutex_lock(&checkpoint_lock);
+    if(checkpoint_failed) {
+        printf("Last save FAILED; the next save rewrites all data.\n");
+    } else if(checkpoint_completed != checkpoint_reported) {
+        printf("Save #%d completed.\n", checkpoint_completed);
+        checkpoint_reported = checkpoint_completed;
+    }
+    pthread_mutex_unlock(&checkpoint_lock);
 }
 
-// Function to load data from files
-void loadData() {
-    FILE *file;
+// Function to load data from files. The tables are read and verified
+// against their checksum sidecars on parallel threads. Returns 0 if a
+// committed journal cannot be applied or any file is torn or corrupt;
+// message then names the exact file and block at fault.
+// Otherwise message holds any notes for the user (or is empty).
+int loadData(char* message, int message_size) {
+    // Finish any save that was interrupted after its journal was committed;
+    // the tables on disk are stale until it is applied
+    if(!replayJournal()) {
+        snprintf(message, message_size,
+                 "Error applying %s: a committed save could not be written to the data files.\n"
+                 "Check free space and permissions, then start again; the journal is kept.\n",
+                 FILENAME_JOURNAL);
+        return 0;
+    }
     
-    // Load books
-    file = fopen(FILENAME_BOOKS, "rb");
-    if(file != NULL) {
-        book_count = fread(books, sizeof(Book), MAX_BOOKS, file);
-        fclose(file);
+    LoadResult results[TABLE_COUNT];
+    pthread_t threads[TABLE_COUNT];
+    int started[TABLE_COUNT];
+    for(int t = 0; t < TABLE_COUNT; t++) {
+        results[t].table = &table_files[t];
+        results[t].generated = 0;
+        results[t].error[0] = '\0';
+        started[t] = pthread_create(&threads[t], NULL, loadTable, &results[t]) == 0;
+        if(!started[t]) {
+            loadTable(&results[t]);
+        }
     }
     
-    // Load members
-    file = fopen(FILENAME_MEMBERS, "rb");
-    if(file != NULL) {
-        member_count = fread(members, sizeof(Member), MAX_MEMBERS, file);
-        fclose(file);
+    int failed = 0;
+    int used = 0;
+    message[0] = '\0';
+    for(int t = 0; t < TABLE_COUNT; t++) {
+        if(started[t]) {
+            pthread_join(threads[t], NULL);
+        }
+        if(used >= message_size - 1) {
+            failed |= results[t].error[0] != '\0';
+        } else if(results[t].error[0]) {
+            used += snprintf(message + used, message_size - used, "Error loading %s\n", results[t].error);
+            failed = 1;
+        } else if(results[t].generated) {
+            used += snprintf(message + used, message_size - used, "Note: %s had no checksums; created %s.\n",
+                             table_files[t].filename, table_files[t].checksum_filename);
+        }
+    }
+    if(failed) {
+        return 0;
     }
     
-    // Load transactions
-    file = fopen(FILENAME_TRANSACTIONS, "rb");
-    if(file != NULL) {
-        transaction_count = fread(transactions, sizeof(Transaction), MAX_BOOKS * 10, file);
-        fclose(file);
+    for(int t = 0; t < TABLE_COUNT; t++) {
+        table_files[t].persisted = *table_files[t].count;
+    }
+    
+    // Both depend on more than one table, so they run after the loaders
+    loadFines();
+    if(history_loaded) {
+        rebuildPopularity();
+        // Lets the next start skip the history
+        writeOpenLoans(open_loans, open_loan_count, transaction_count);
+    }
+    if(isbn_filter_unsaved) {
+        isbn_filter_unsaved = !writeIsbnFilter(&isbn_filter[0][0], isbn_filter_blocks);
     }
+    sweepExpiredHolds();
+    return 1;
 }
 
-// Function to save data to files
-void saveData() {
-    FILE *file;
+// Loader thread: reads one table, verifies its block checksums and builds
+// the table's in-memory indexes
+void* loadTable(void* arg) {
+    LoadResult* result = arg;
+    TableFile* tf = result->table;
+    *tf->count = 0;
     
-    // Save books
-    file = fopen(FILENAME_BOOKS, "wb");
-    if(file != NULL) {
-        fwrite(books, sizeof(Book), book_count, file);
-        fclose(file);
+    if(tf->records == transactions) {
+        if(loadOpenLoans(result)) {
+            return NULL;
+        }
+        // No usable openloans.dat: read the whole history now
+        history_loaded = 1;
+        open_loan_count = 0;
     }
     
-    // Save members
-    file = fopen(FILENAME_MEMBERS, "wb");
-    if(file != NULL) {
-        fwrite(members, sizeof(Member), member_count, file);
-        fclose(file);
+    int unverified = 0;
+    int loaded = readVerifiedTable(tf->filename, tf->checksum_filename, tf->record_size, tf->capacity,
+                                   tf->records, tf->count, &unverified, result->error, sizeof(result->error));
+    if(loaded <= 0) {
+        return NULL;    // fresh library, or error set
+    }
+    if(unverified) {
+        // Data written before checksums existed: adopt it as the baseline
+        if(!writeChecksumFile(tf)) {
+            snprintf(result->error, sizeof(result->error),
+                     "%s: cannot create checksum file", tf->checksum_filename);
+            return NULL;
+        }
+        result->generated = 1;
     }
     
-    // Save transactions
-    file = fopen(FILENAME_TRANSACTIONS, "wb");
-    if(file != NULL) {
-        fwrite(transactions, sizeof(Transaction), transaction_count, file);
-        fclose(file);
+    if(tf->records == books) {
+        for(int i = 0; i < book_count; i++) {
+            foldBookRecord(i);
+        }
+        rebuildFuzzyIndex();
+        if(!loadIsbnFilter()) {
+            rebuildIsbnFilter();
+            isbn_filter_unsaved = 1;
+        }
+    } else if(tf->records == transactions) {
+        rebuildLoanHistory();
+        rebuildIssueDateIndex();
+        for(int i = 0; i < transaction_count; i++) {
+            if(!transactions[i].returned) {
+                setLoanOpen(i, 1);
+            }
+        }
+    } else if(tf->records == holds) {
+        rebuildHoldQueues();
     }
+    return NULL;
 }
 
-// Function to add a new book
-void addBook() {
-    system("clear || cls");
-    printHeader("ADD NEW BOOK");
-    
-    if(book_count >= MAX_BOOKS) {
-        printf("Book storage is full!\n");
-        return;
+// Helper function to read a whole data file into data and verify it
+// against its checksum sidecar. Used for this branch's tables and, read
+// only, for other branches'. Returns -1 if the data file does not exist,
+// 0 with error set if it is torn or corrupt, 1 once loaded; unverified is
+// set when there is no sidecar yet.
+int readVerifiedTable(const char* path, const char* checksum_path, size_t record_size, int capacity,
+                      void* data, int* count, int* unverified, char* error, size_t error_size) {
+    *count = 0;
+    *unverified = 0;
+    error[0] = '\0';
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) {
+        return -1;
     }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
     
-    Book newBook;
-    
-    printf("Enter Book Details:\n");
-    printf("===================\n");
-    
-    newBook.id = book_count > 0 ? books[book_count-1].id + 1 : 1001;
-    
-    printf("Title: ");
-    fgets(newBook.title, MAX_TITLE, stdin);
-    newBook.title[strcspn(newBook.title, "\n")] = 0;
-    
-    printf("Author: ");
-    fgets(newBook.author, MAX_AUTHOR, stdin);
-    newBook.author[strcspn(newBook.author, "\n")] = 0;
+    long records = size / (long)record_size;
+    if(size % (long)record_size != 0) {
+        snprintf(error, error_size,
+                 "%s: size %ld is not a multiple of the %zu-byte record (torn write?)",
+                 path, size, record_size);
+    } else if(records > capacity) {
+        snprintf(error, error_size,
+                 "%s: holds %ld records, capacity is %d", path, records, capacity);
+    } else if(fread(data, record_size, records, file) != (size_t)records) {
+        snprintf(error, error_size, "%s: short read", path);
+    }
+    fclose(file);
+    if(error[0]) {
+        return 0;
+    }
+    *count = records;
     
-    do {
-        printf("ISBN (13 digits): ");
-        fgets(newBook.ISBN, 14, stdin);
-        newBook.ISBN[strcspn(newBook.ISBN, "\n")] = 0;
-        
-        if(!isISBNValid(newBook.ISBN)) {
-            printf("Invalid ISBN format! Please enter 13 digits.\n");
+    file = fopen(checksum_path, "rb");
+    if(file == NULL) {
+        *unverified = 1;
+    } else {
+        ChecksumHeader header;
+        int blocks = (records + CRC_BLOCK_RECORDS - 1) / CRC_BLOCK_RECORDS;
+        uint32_t stored[MAX_CRC_BLOCKS];
+        if(fread(&header, sizeof(header), 1, file) != 1 || header.magic != CRC_MAGIC ||
+           header.record_size != record_size || header.block_records != CRC_BLOCK_RECORDS) {
+            snprintf(error, error_size,
+                     "%s: missing or invalid checksum header", checksum_path);
+        } else if(header.record_count != (uint32_t)records) {
+            snprintf(error, error_size,
+                     "%s: has %ld records but %s expects %u",
+                     path, records, checksum_path, header.record_count);
+        } else if(fread(stored, sizeof(uint32_t), blocks, file) != (size_t)blocks) {
+            snprintf(error, error_size,
+                     "%s: truncated checksum list", checksum_path);
+        } else {
+            for(int b = 0; b < blocks; b++) {
+                int first = b * CRC_BLOCK_RECORDS;
+                int n = records - first < CRC_BLOCK_RECORDS ? records - first : CRC_BLOCK_RECORDS;
+                uint32_t crc = crc32c(0, (char*)data + (size_t)first * record_size,
+                                      (size_t)n * record_size);
+                if(crc != stored[b]) {
+                    snprintf(error, error_size,
+                             "%s: checksum mismatch in block %d (records %d-%d)",
+                             path, b, first, first + n - 1);
+                    break;
+                }
+            }
         }
-    } while(!isISBNValid(newBook.ISBN));
-    
-    printf("Publication Year: ");
-    scanf("%d", &newBook.year);
-    clearInputBuffer();
-    
-    printf("Category: ");
-    fgets(newBook.category, 30, stdin);
-    newBook.category[strcspn(newBook.category, "\n")] = 0;
-    
-    printf("Total Quantity: ");
-    scanf("%d", &newBook.quantity);
-    clearInputBuffer();
-    
-    newBook.available = newBook.quantity;
-    
-    books[book_count++] = newBook;
-    
-    printf("\nBook added successfully! Book ID: %d\n", newBook.id);
+        fclose(file);
+    }
+    return error[0] == '\0';
 }
 
-// Function to view all books
-void viewBooks() {
-    system("clear || cls");
-    printHeader("VIEW ALL BOOKS");
+// Helper function to load only the open-loan working set of transactions.dat:
+// the checksum blocks holding a slot listed in openloans.dat, plus the last
+// block so new transaction ids follow on. Returns 0 when openloans.dat is
+// missing or stale, or a block fails its checksum; the caller then reads
+// the whole file, which also reports any damage in detail.
+int loadOpenLoans(LoadResult* result) {
+    TableFile* tf = result->table;
+    static int slots[MAX_BOOKS * 10];
+    OpenLoansHeader header;
+    FILE *file = fopen(FILENAME_OPEN_LOANS, "rb");
+    if(file == NULL) {
+        return 0;
+    }
+    int ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == OPEN_LOANS_MAGIC &&
+             header.transaction_count >= 0 && header.transaction_count <= tf->capacity &&
+             header.open_count >= 0 && header.open_count <= header.transaction_count &&
+             fread(slots, sizeof(int), header.open_count, file) == (size_t)header.open_count;
+    fclose(file);
     
-    if(book_count == 0) {
-        printf("No books found!\n");
-        return;
+    // The list describes one exact file length; anything else means a save
+    // happened without it
+    int records = ok ? header.transaction_count : 0;
+    int blocks = (records + CRC_BLOCK_RECORDS - 1) / CRC_BLOCK_RECORDS;
+    struct stat info;
+    int fd = ok ? open(tf->filename, O_RDONLY) : -1;
+    ok = fd >= 0 && fstat(fd, &info) == 0 && info.st_size == (off_t)records * (off_t)tf->record_size;
+    
+    ChecksumHeader crc_header;
+    uint32_t stored[MAX_CRC_BLOCKS];
+    file = ok ? fopen(tf->checksum_filename, "rb") : NULL;
+    ok = file != NULL && fread(&crc_header, sizeof(crc_header), 1, file) == 1 &&
+         crc_header.magic == CRC_MAGIC && crc_header.record_size == tf->record_size &&
+         crc_header.record_count == (uint32_t)records && crc_header.block_records == CRC_BLOCK_RECORDS &&
+         fread(stored, sizeof(uint32_t), blocks, file) == (size_t)blocks;
+    if(file != NULL) {
+        fclose(file);
     }
     
-    printf("%-5s %-30s %-20s %-13s %-8s %-10s %-10s %-15s\n", 
-           "ID", "Title", "Author", "ISBN", "Year", "Quantity", "Available", "Category");
-    printf("--------------------------------------------------------------------------------------------------------\n");
+    memset(history_block_loaded, 0, sizeof(history_block_loaded));
+    if(ok && records > 0) {
+        history_block_loaded[blocks - 1] = 1;
+    }
+    for(int i = 0; ok && i < header.open_count; i++) {
+        ok = slots[i] >= 0 && slots[i] < records;
+        if(ok) history_block_loaded[slots[i] / CRC_BLOCK_RECORDS] = 1;
+    }
+    for(int b = 0; ok && b < blocks; b++) {
+        if(!history_block_loaded[b]) continue;
+        int first = b * CRC_BLOCK_RECORDS;
+        int n = records - first < CRC_BLOCK_RECORDS ? records - first : CRC_BLOCK_RECORDS;
+        ssize_t length = (ssize_t)n * tf->record_size;
+        char* block = (char*)tf->records + (size_t)first * tf->record_size;
+        ok = pread(fd, block, length, (off_t)first * tf->record_size) == length &&
+             crc32c(0, block, length) == stored[b];
+    }
+    if(fd >= 0) {
+        close(fd);
+    }
+    if(!ok) {
+        memset(history_block_loaded, 0, sizeof(history_block_loaded));
+        return 0;
+    }
     
-    for(int i = 0; i < book_count; i++) {
-        printf("%-5d %-30s %-20s %-13s %-8d %-10d %-10d %-15s\n",
-               books[i].id,
-               books[i].title,
-               books[i].author,
-               books[i].ISBN,
-               books[i].year,
-               books[i].quantity,
-               books[i].available,
-               books[i].category);
+    *tf->count = records;
+    history_file_count = records;
+    open_loan_count = 0;
+    for(int i = 0; i < header.open_count; i++) {
+        // Loans returned by a save that did not get to rewrite the list
+        if(!transactions[slots[i]].returned) {
+            setLoanOpen(slots[i], 1);
+        }
     }
+    return 1;
 }
 
-// Function to search for a book
-void searchBook() {
-    system("clear || cls");
-    printHeader("SEARCH BOOK");
-    
-    int choice;
-    printf("Search by:\n");
-    printf("1. Book ID\n");
-    printf("2. ISBN\n");
-    printf("3. Title\n");
-    printf("4. Author\n");
-    printf("5. Category\n");
-    printf("Enter choice: ");
-    scanf("%d", &choice);
-    clearInputBuffer();
+// Helper function to page in the transactions skipped at startup and build
+// the indexes over the full history. Returns 1 once the history is in
+// memory.
+int ensureHistoryLoaded() {
+    if(history_loaded) {
+        return 1;
+    }
+    int blocks = (history_file_count + CRC_BLOCK_RECORDS - 1) / CRC_BLOCK_RECORDS;
+    if(!loadHistoryBlocks(0, blocks)) {
+        return 0;
+    }
     
-    char searchTerm[100];
-    printf("Enter search term: ");
-    fgets(searchTerm, 100, stdin);
-    searchTerm[strcspn(searchTerm, "\n")] = 0;
+    history_loaded = 1;
+    rebuildLoanHistory();
+    rebuildIssueDateIndex();
+    rebuildPopularity();
+    return 1;
+}
+
+// Helper function to page in the blocks first_block..end_block-1 of the
+// transactions skipped at startup, checking each against its CRC. Only the
+// requested sidecar entries are read and only the touched pages of the map
+// are faulted in, so the cost follows the range, not the file. The blocks
+// still on disk hold no open loan and are below the last block, so no save
+// rewrites them and the file can be mapped while the writer runs. Returns
+// 1 once the range is in memory.
+int loadHistoryBlocks(int first_block, int end_block) {
+    TableFile* tf = &table_files[TABLE_TRANSACTIONS];
+    int file_blocks = (history_file_count + CRC_BLOCK_RECORDS - 1) / CRC_BLOCK_RECORDS;
+    if(end_block > file_blocks) {
+        end_block = file_blocks;
+    }
+    int missing = 0;
+    for(int b = first_block; b < end_block; b++) {
+        missing |= !history_block_loaded[b];
+    }
+    if(!missing) {
+        return 1;
+    }
+    size_t length = (size_t)history_file_count * tf->record_size;
     
-    printf("\nSearch Results:\n");
-    printf("%-5s %-30s %-20s %-13s %-8s %-10s %-10s %-15s\n", 
-           "ID", "Title", "Author", "ISBN", "Year", "Quantity", "Available", "Category");
-    printf("--------------------------------------------------------------------------------------------------------\n");
+    ChecksumHeader header;
+    int crc_fd = open(tf->checksum_filename, O_RDONLY);
+    int ok = crc_fd >= 0 && pread(crc_fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+             header.magic == CRC_MAGIC && header.record_count >= (uint32_t)history_file_count;
     
-    int found = 0;
-    for(int i = 0; i < book_count; i++) {
-        int match = 0;
-        
-        switch(choice) {
-            case 1: 
-                if(books[i].id == atoi(searchTerm)) match = 1;
-                break;
-            case 2:
-                if(strstr(books[i].ISBN, searchTerm) != NULL) match = 1;
-                break;
-            case 3:
-                if(strstr(books[i].title, searchTerm) != NULL) match = 1;
-                break;
-            case 4:
-                if(strstr(books[i].author, searchTerm) != NULL) match = 1;
-                break;
-            case 5:
-                if(strstr(books[i].category, searchTerm) != NULL) match = 1;
-                break;
+    int fd = ok ? open(tf->filename, O_RDONLY) : -1;
+    char* map = fd >= 0 ? mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    ok = fd >= 0 && map != MAP_FAILED;
+    for(int b = first_block; ok && b < end_block; b++) {
+        if(history_block_loaded[b]) continue;
+        int first = b * CRC_BLOCK_RECORDS;
+        size_t offset = (size_t)first * tf->record_size;
+        size_t bytes = (size_t)CRC_BLOCK_RECORDS * tf->record_size;
+        uint32_t stored;
+        if(pread(crc_fd, &stored, sizeof(stored), sizeof(header) + (off_t)b * sizeof(stored)) != (ssize_t)sizeof(stored)) {
+            ok = 0;
+            break;
         }
-        
-        if(match) {
-            found = 1;
-            printf("%-5d %-30s %-20s %-13s %-8d %-10d %-10d %-15s\n",
-                   books[i].id,
-                   books[i].title,
-                   books[i].author,
-                   books[i].ISBN,
-                   books[i].year,
-                   books[i].quantity,
-                   books[i].available,
-                   books[i].category);
+        if(crc32c(0, map + offset, bytes) != stored) {
+            printf("Error: %s: checksum mismatch in block %d (records %d-%d)!\n",
+                   tf->filename, b, first, first + CRC_BLOCK_RECORDS - 1);
+            ok = 0;
+            break;
         }
+        memcpy((char*)tf->records + offset, map + offset, bytes);
+        history_block_loaded[b] = 1;
     }
-    
-    if(!found) {
-        printf("No books found matching the search criteria.\n");
+    if(map != NULL && map != MAP_FAILED) {
+        munmap(map, length);
     }
+    if(fd >= 0) {
+        close(fd);
+    }
+    if(crc_fd >= 0) {
+        close(crc_fd);
+    }
+    if(!ok) {
+        printf("Error: cannot read the loan history in %s!\n", tf->filename);
+    }
+    return ok;
 }
 
-// Function to update a book
-void updateBook() {
-    system("clear || cls");
-    printHeader("UPDATE BOOK");
-    
-    int id;
-    printf("Enter Book ID to update: ");
-    scanf("%d", &id);
-    clearInputBuffer();
-    
-    int index = findBookById(id);
-    if(index == -1) {
-        printf("Book not found!\n");
-        return;
+// Helper function to add a transaction slot to, or remove it from, the
+// ascending open-loan set
+void setLoanOpen(int slot, int open) {
+    int low = 0, high = open_loan_count;
+    while(low < high) {
+        int mid = (low + high) / 2;
+        if(open_loans[mid] < slot) low = mid + 1;
+        else high = mid;
     }
-    
-    printf("\nCurrent Details:\n");
-    printf("Title: %s\n", books[index].title);
-    printf("Author: %s\n", books[index].author);
-    printf("ISBN: %s\n", books[index].ISBN);
-    printf("Year: %d\n", books[index].year);
-    printf("Category: %s\n", books[index].category);
-    printf("Quantity: %d\n", books[index].quantity);
-    printf("Available: %d\n", books[index].available);
-    
-    printf("\nEnter new details (press Enter to keep current value):\n");
-    
-    printf("Title [%s]: ", books[index].title);
-    char temp[100];
-    fgets(temp, 100, stdin);
-    temp[strcspn(temp, "\n")] = 0;
-    if(strlen(temp) > 0) {
-        strcpy(books[index].title, temp);
+    int present = low < open_loan_count && open_loans[low] == slot;
+    if(open && !present) {
+        memmove(&open_loans[low + 1], &open_loans[low], (open_loan_count - low) * sizeof(int));
+        open_loans[low] = slot;
+        open_loan_count++;
+    } else if(!open && present) {
+        memmove(&open_loans[low], &open_loans[low + 1], (open_loan_count - low - 1) * sizeof(int));
+        open_loan_count--;
+    }
+}
+
+// Helper function to write openloans.dat for a transactions.dat of
+// transaction_count records, via a temporary file renamed into place
+int writeOpenLoans(const int* slots, int count, int transaction_count) {
+    FILE *file = fopen(FILENAME_OPEN_LOANS ".tmp", "wb");
+    if(file == NULL) {
+        return 0;
+    }
+    OpenLoansHeader header = {OPEN_LOANS_MAGIC, transaction_count, count};
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(slots, sizeof(int), count, file) == (size_t)count;
+    ok = fflush(file) == 0 && fsync(fileno(file)) == 0 && ok;
+    fclose(file);
+    if(!ok || rename(FILENAME_OPEN_LOANS ".tmp", FILENAME_OPEN_LOANS) != 0) {
+        unlink(FILENAME_OPEN_LOANS ".tmp");
+        return 0;
+    }
+    return syncDirectory();
+}
+
+// Function to save data to files. Only records marked dirty are saved: they
+// are copied into a journal-format snapshot here, and the background
+// writer commits the journal and then pwrite()s them in place, so a crash
+// at any point leaves either the old or the new state on disk. Returns 0 if
+// the snapshot could not be allocated.
+int saveData() {
+    // A failed checkpoint lost its snapshot, so fall back to a full rewrite
+    pthread_mutex_lock(&checkpoint_lock);
+    int failed = checkpoint_failed;
+    checkpoint_failed = 0;
+    pthread_mutex_unlock(&checkpoint_lock);
+    if(failed) {
+        for(int t = 0; t < TABLE_COUNT; t++) {
+            if(t == TABLE_TRANSACTIONS && !history_loaded) {
+                // Blocks never paged in are unchanged on disk
+                markDirtyFrom(t, history_file_count);
+                for(int i = 0; i < history_file_count; i++) {
+                    if(history_block_loaded[i / CRC_BLOCK_RECORDS]) markDirty(t, i);
+                }
+            } else {
+                markDirtyFrom(t, 0);
+            }
+            table_files[t].persisted = -1;
+        }
     }
     
-    printf("Author [%s]: ", books[index].author);
-    fgets(temp, 100, stdin);
-    temp[strcspn(temp, "\n")] = 0;
-    if(strlen(temp) > 0) {
-        strcpy(books[index].author, temp);
+    // Fees charged at return are kept beside the tables, not in the journal
+    if(fines_unsaved) {
+        fines_unsaved = !saveFines();
     }
     
-    printf("Category [%s]: ", books[index].category);
-    fgets(temp, 100, stdin);
-    temp[strcspn(temp, "\n")] = 0;
-    if(strlen(temp) > 0) {
-        strcpy(books[index].category, temp);
+    // Journal layout per changed table:
+    //   table, final record count, n, then n x (index, record bytes)
+    // followed by JOURNAL_MAGIC once every table has been written.
+    long size = sizeof(uint32_t);
+    int changed = 0;
+    int transactions_changed = 0;
+    int books_changed = 0;
+    for(int t = 0; t < TABLE_COUNT; t++) {
+        TableFile* tf = &table_files[t];
+        if(tf->dirty_count == 0 && *tf->count == tf->persisted) {
+            continue;
+        }
+        changed = 1;
+        transactions_changed |= t == TABLE_TRANSACTIONS;
+        books_changed |= t == TABLE_BOOKS;
+        size += 3 * sizeof(int);
+        for(int d = 0; d < tf->dirty_count; d++) {
+            if(tf->dirty_list[d] < *tf->count) {
+                size += sizeof(int) + tf->record_size;
+            }
+        }
+    }
+    if(!changed) {
+        return 1;
     }
     
-    printf("Year [%d]: ", books[index].year);
-    fgets(temp, 100, stdin);
-    temp[strcspn(temp, "\n")] = 0;
-    if(strlen(temp) > 0) {
-        books[index].year = atoi(temp);
+    Checkpoint checkpoint;
+    checkpoint.buffer = malloc(size);
+    checkpoint.size = size;
+    checkpoint.open_slots = NULL;
+    checkpoint.open_count = open_loan_count;
+    checkpoint.transaction_count = transaction_count;
+    checkpoint.isbn_filter = NULL;
+    checkpoint.isbn_filter_blocks = isbn_filter_blocks;
+    if(transactions_changed) {
+        checkpoint.open_slots = malloc(sizeof(int) * (open_loan_count > 0 ? open_loan_count : 1));
+    }
+    if(books_changed) {
+        checkpoint.isbn_filter = malloc(sizeof(isbn_filter[0]) * isbn_filter_blocks);
+    }
+    if(checkpoint.buffer == NULL || (transactions_changed && checkpoint.open_slots == NULL) ||
+       (books_changed && checkpoint.isbn_filter == NULL)) {
+        free(checkpoint.buffer);
+        free(checkpoint.open_slots);
+        free(checkpoint.isbn_filter);
+        return 0;
+    }
+    if(transactions_changed) {
+        memcpy(checkpoint.open_slots, open_loans, sizeof(int) * open_loan_count);
+    }
+    if(books_changed) {
+        memcpy(checkpoint.isbn_filter, isbn_filter, sizeof(isbn_filter[0]) * isbn_filter_blocks);
     }
     
-    printf("Total Quantity [%d]: ", books[index].quantity);
-    fgets(temp, 100, stdin);
-    temp[strcspn(temp, "\n")] = 0;
-    if(strlen(temp) > 0) {
-        int newQty = atoi(temp);
-        int diff = newQty - books[index].quantity;
-        books[index].quantity = newQty;
-        books[index].available += diff;
+    char* out = checkpoint.buffer;
+    for(int t = 0; t < TABLE_COUNT; t++) {
+        TableFile* tf = &table_files[t];
+        if(tf->dirty_count == 0 && *tf->count == tf->persisted) {
+            continue;
+        }
+        
+        int n = 0;
+        for(int d = 0; d < tf->dirty_count; d++) {
+            if(tf->dirty_list[d] < *tf->count) n++;
+        }
+        int header[3] = {t, *tf->count, n};
+        memcpy(out, header, sizeof(header));
+        out += sizeof(header);
+        for(int d = 0; d < tf->dirty_count; d++) {
+            int index = tf->dirty_list[d];
+            tf->dirty[index] = 0;
+            if(index >= *tf->count) continue;
+            memcpy(out, &index, sizeof(int));
+            out += sizeof(int);
+            memcpy(out, (char*)tf->records + (size_t)index * tf->record_size, tf->record_size);
+            out += tf->record_size;
+        }
+        tf->dirty_count = 0;
+        tf->persisted = *tf->count;
     }
+    uint32_t magic = JOURNAL_MAGIC;
+    memcpy(out, &magic, sizeof(magic));
     
-    printf("\nBook updated successfully!\n");
+    pthread_mutex_lock(&checkpoint_lock);
+    checkpoint.sequence = ++checkpoint_sequence;
+    if(!checkpoint_running) {
+        // No writer thread: save synchronously
+        pthread_mutex_unlock(&checkpoint_lock);
+        int ok = writeCheckpoint(&checkpoint);
+        pthread_mutex_lock(&checkpoint_lock);
+        checkpoint_completed = checkpoint.sequence;
+        checkpoint_failed |= !ok;
+        checkpoint_failures += !ok;
+        pthread_mutex_unlock(&checkpoint_lock);
+        return 1;
+    }
+    while(checkpoint_pending == CHECKPOINT_QUEUE_SIZE) {
+        pthread_cond_wait(&checkpoint_not_full, &checkpoint_lock);
+    }
+    checkpoint_queue[checkpoint_tail] = checkpoint;
+    checkpoint_tail = (checkpoint_tail + 1) % CHECKPOINT_QUEUE_SIZE;
+    checkpoint_pending++;
+    pthread_cond_signal(&checkpoint_not_empty);
+    pthread_mutex_unlock(&checkpoint_lock);
+    return 1;
 }
 
-// Function to delete a book
-void deleteBook() {
-    system("clear || cls");
-    printHeader("DELETE BOOK");
-    
-    int id;
-    printf("Enter Book ID to delete: ");
-    scanf("%d", &id);
-    clearInputBuffer();
-    
-    int index = findBookById(id);
-    if(index == -1) {
-        printf("Book not found!\n");
-        return;
+// Helper function to commit a snapshot to the journal, apply it to the data
+// files and free it. A journal an earlier checkpoint committed but could not
+// apply is finished first; while it still cannot be applied it is left for
+// loadData and this snapshot is dropped (the next save rewrites in full).
+// Returns 1 on success.
+int writeCheckpoint(Checkpoint* checkpoint) {
+    int ok = 0;
+    int journal_clear = replayJournal();
+    int fd = journal_clear ? open(FILENAME_JOURNAL, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    if(fd >= 0) {
+        ok = write(fd, checkpoint->buffer, checkpoint->size) == checkpoint->size &&
+             fsync(fd) == 0;
+        close(fd);
+        // The journal only counts as committed once its name is durable too
+        ok = ok && syncDirectory();
     }
     
-    printf("\nBook Details:\n");
-    printf("Title: %s\n", books[index].title);
-    printf("Author: %s\n", books[index].author);
-    printf("ISBN: %s\n", books[index].ISBN);
-    
-    if(books[index].available != books[index].quantity) {
-        printf("Cannot delete book! Some copies are still issued.\n");
-        return;
+    if(!journal_clear) {
+        // The unapplied journal must survive until it is applied
+    } else if(!ok) {
+        unlink(FILENAME_JOURNAL);
+        syncDirectory();
+    } else if(applyJournal(checkpoint->buffer, checkpoint->size)) {
+        unlink(FILENAME_JOURNAL);
+        syncDirectory();
+        // Without a current list the next start reads the whole history
+        if(checkpoint->open_slots != NULL &&
+           !writeOpenLoans(checkpoint->open_slots, checkpoint->open_count, checkpoint->transaction_count)) {
+            unlink(FILENAME_OPEN_LOANS);
+        }
+        if(checkpoint->isbn_filter != NULL &&
+           !writeIsbnFilter(checkpoint->isbn_filter, checkpoint->isbn_filter_blocks)) {
+            unlink(FILENAME_ISBN_FILTER);
+        }
+    } else {
+        // Committed but not applied: loadData retries it on next start
+        ok = 0;
     }
     
-    char confirm;
-    printf("Are you sure you want to delete this book? (y/n): ");
-    scanf("%c", &confirm);
-    clearInputBuffer();
-    
-    if(confirm == 'y' || confirm == 'Y') {
-        for(int i = index; i < book_count - 1; i++) {
-            books[i] = books[i + 1];
+    free(checkpoint->buffer);
+    free(checkpoint->open_slots);
+    free(checkpoint->isbn_filter);
+    checkpoint->buffer = NULL;
+    checkpoint->open_slots = NULL;
+    checkpoint->isbn_filter = NULL;
+    return ok;
+}
+
+// Background thread that drains the checkpoint queue in order
+void* checkpointWriter(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&checkpoint_lock);
+    for(;;) {
+        while(checkpoint_pending == 0 && !checkpoint_stopping) {
+            pthread_cond_wait(&checkpoint_not_empty, &checkpoint_lock);
         }
-        book_count--;
-        printf("Book deleted successfully!\n");
-    } else {
-        printf("Deletion cancelled.\n");
+        if(checkpoint_pending == 0) {
+            break;
+        }
+        Checkpoint checkpoint = checkpoint_queue[checkpoint_head];
+        pthread_mutex_unlock(&checkpoint_lock);
+        
+        int ok = writeCheckpoint(&checkpoint);
+        
+        pthread_mutex_lock(&checkpoint_lock);
+        checkpoint_head = (checkpoint_head + 1) % CHECKPOINT_QUEUE_SIZE;
+        checkpoint_pending--;
+        checkpoint_completed = checkpoint.sequence;
+        checkpoint_failed |= !ok;
+        checkpoint_failures += !ok;
+        pthread_cond_signal(&checkpoint_not_full);
+        pthread_cond_broadcast(&checkpoint_done);
     }
+    pthread_mutex_unlock(&checkpoint_lock);
+    return NULL;
 }
 
-// Function to add a new member
-void addMember() {
-    system("clear || cls");
-    printHeader("ADD NEW MEMBER");
-    
-    if(member_count >= MAX_MEMBERS) {
-        printf("Member storage is full!\n");
+// Helper function to start the background writer; saves run synchronously
+// if the thread cannot be created
+void startCheckpointWriter() {
+    checkpoint_stopping = 0;
+    checkpoint_running = pthread_create(&checkpoint_thread, NULL, checkpointWriter, NULL) == 0;
+}
+
+// Helper function to wait for queued saves and stop the background writer
+void stopCheckpointWriter() {
+    if(!checkpoint_running) {
         return;
     }
-    
-    Member newMember;
-    
-    printf("Enter Member Details:\n");
-    printf("=====================\n");
-    
-    newMember.id = member_count > 0 ? members[member_count-1].id + 1 : 2001;
-    
-    printf("Name: ");
-    fgets(newMember.name, MAX_NAME, stdin);
-    newMember.name[strcspn(newMember.name, "\n")] = 0;
-    
-    // Generate membership ID
-    sprintf(newMember.membership_id, "MEM%04d", newMember.id);
-    
-    printf("Email: ");
-    fgets(newMember.email, 50, stdin);
-    newMember.email[strcspn(newMember.email, "\n")] = 0;
-    
-    printf("Phone: ");
-    fgets(newMember.phone, 15, stdin);
-    newMember.phone[strcspn(newMember.phone, "\n")] = 0;
-    
-    newMember.books_issued = 0;
-    
-    getCurrentDate(newMember.join_date);
-    
-    members[member_count++] = newMember;
-    
-    printf("\nMember added successfully!\n");
-    printf("Member ID: %d\n", newMember.id);
-    printf("Membership ID: %s\n", newMember.membership_id);
+    pthread_mutex_lock(&checkpoint_lock);
+    checkpoint_stopping = 1;
+    pthread_cond_signal(&checkpoint_not_empty);
+    pthread_mutex_unlock(&checkpoint_lock);
+    pthread_join(checkpoint_thread, NULL);
+    checkpoint_running = 0;
 }
 
-// Function to view all members
-void viewMembers() {
-    system("clear || cls");
-    printHeader("VIEW ALL MEMBERS");
-    
-    if(member_count == 0) {
-        printf("No members found!\n");
-        return;
+// Helper function to apply a committed journal left on disk. A journal
+// without its trailer was torn before commit and the data files were never
+// touched, so it is discarded. Returns 1 when the files are up to date.
+int replayJournal() {
+    FILE *file = fopen(FILENAME_JOURNAL, "rb");
+    if(file == NULL) {
+        return 1;
     }
     
-    printf("%-5s %-20s %-15s %-25s %-15s %-10s %-15s\n", 
-           "ID", "Name", "Membership ID", "Email", "Phone", "Issued", "Join Date");
-    printf("--------------------------------------------------------------------------------------------------\n");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* buffer = size > 0 ? malloc(size) : NULL;
+    int complete = buffer != NULL && fread(buffer, 1, size, file) == (size_t)size;
+    fclose(file);
     
-    for(int i = 0; i < member_count; i++) {
-        printf("%-5d %-20s %-15s %-25s %-15s %-10d %-15s\n",
-               members[i].id,
-               members[i].name,
-               members[i].membership_id,
-               members[i].email,
-               members[i].phone,
-               members[i].books_issued,
-               members[i].join_date);
+    // Validate the whole journal before touching any data file
+    uint32_t magic = 0;
+    long pos = 0;
+    if(complete && size >= (long)sizeof(magic)) {
+        memcpy(&magic, buffer + size - sizeof(magic), sizeof(magic));
+    }
+    complete = complete && magic == JOURNAL_MAGIC;
+    while(complete && pos < size - (long)sizeof(magic)) {
+        int header[3];
+        if(pos + (long)sizeof(header) > size) { complete = 0; break; }
+        memcpy(header, buffer + pos, sizeof(header));
+        if(header[0] < 0 || header[0] >= TABLE_COUNT || header[2] < 0) { complete = 0; break; }
+        pos += sizeof(header) + (long)header[2] * (sizeof(int) + table_files[header[0]].record_size);
+    }
+    complete = complete && pos == size - (long)sizeof(magic);
+    
+    int ok = !complete || applyJournal(buffer, size);
+    free(buffer);
+    if(ok) {
+        unlink(FILENAME_JOURNAL);
+        syncDirectory();
     }
+    return ok;
 }
 
-// Function to search for a member
-void searchMember() {
-    system("clear || cls");
-    printHeader("SEARCH MEMBER");
-    
-    int choice;
-    printf("Search by:\n");
-    printf("1. Member ID\n");
-    printf("2. Membership ID\n");
-    printf("3. Name\n");
-    printf("4. Email\n");
-    printf("Enter choice: ");
-    scanf("%d", &choice);
-    clearInputBuffer();
-    
-    char searchTerm[100];
-    printf("Enter search term: ");
-    fgets(searchTerm, 100, stdin);
-    searchTerm[strcspn(searchTerm, "\n")] = 0;
-    
-    printf("\nSearch Results:\n");
-    printf("%-5s %-20s %-15s %-25s %-15s %-10s %-15s\n", 
-           "ID", "Name", "Membership ID", "Email", "Phone", "Issued", "Join Date");
-    printf("--------------------------------------------------------------------------------------------------\n");
-    
-    int found = 0;
-    for(int i = 0; i < member_count; i++) {
-        int match = 0;
+// Helper function to fsync the data directory, making file creations,
+// renames and unlinks in it durable. Returns 1 on success.
+int syncDirectory() {
+    int fd = open(".", O_RDONLY);
+    if(fd < 0) {
+        return 0;
+    }
+    int ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+// Helper function to pwrite() the records of a validated journal image in
+// place, truncate shrunken tables and fsync each touched file
+int applyJournal(const char* buffer, long size) {
+    int ok = 1;
+    long pos = 0;
+    long end = size - sizeof(uint32_t);
+    while(pos < end) {
+        int header[3];
+        memcpy(header, buffer + pos, sizeof(header));
+        pos += sizeof(header);
+        TableFile* tf = &table_files[header[0]];
+        unsigned char touched[MAX_CRC_BLOCKS] = {0};
         
-        switch(choice) {
-            case 1: 
-                if(members[i].id == atoi(searchTerm)) match = 1;
-                break;
-            case 2:
-                if(strstr(members[i].membership_id, searchTerm) != NULL) match = 1;
-                break;
-            case 3:
-                if(strstr(members[i].name, searchTerm) != NULL) match = 1;
-                break;
-            case 4:
-                if(strstr(members[i].email, searchTerm) != NULL) match = 1;
-                break;
+        int fd = open(tf->filename, O_RDWR | O_CREAT, 0644);
+        if(fd < 0) {
+            return 0;
+        }
+        for(int r = 0; r < header[2]; r++) {
+            int index;
+            memcpy(&index, buffer + pos, sizeof(int));
+            pos += sizeof(int);
+            touched[index / CRC_BLOCK_RECORDS] = 1;
+            off_t offset = (off_t)index * tf->record_size;
+            if(pwrite(fd, buffer + pos, tf->record_size, offset) != (ssize_t)tf->record_size) {
+                ok = 0;
+            }
+            pos += tf->record_size;
+        }
+        // Drop records removed by deletions
+        if(ftruncate(fd, (off_t)header[1] * tf->record_size) != 0 || fsync(fd) != 0) {
+            ok = 0;
         }
         
-        if(match) {
-            found = 1;
-            printf("%-5d %-20s %-15s %-25s %-15s %-10d %-15s\n",
-                   members[i].id,
-                   members[i].name,
-                   members[i].membership_id,
-                   members[i].email,
-                   members[i].phone,
-                   members[i].books_issued,
-                   members[i].join_date);
+        // Checksums follow the data, so a crash in between is repaired by
+        // replaying the still-present journal
+        if(header[1] > 0) {
+            touched[(header[1] - 1) / CRC_BLOCK_RECORDS] = 1;
+        }
+        if(ok && !updateChecksums(fd, tf, header[1], touched)) {
+            ok = 0;
         }
+        close(fd);
     }
+    // Data or checksum files created above must exist before the journal
+    // that could recreate them is removed
+    return ok && syncDirectory();
+}
+
+// Helper function to write a complete checksum sidecar from memory
+int writeChecksumFile(TableFile* tf) {
+    int count = *tf->count;
+    int blocks = (count + CRC_BLOCK_RECORDS - 1) / CRC_BLOCK_RECORDS;
+    ChecksumHeader header = {CRC_MAGIC, tf->record_size, count, CRC_BLOCK_RECORDS};
     
-    if(!found) {
-        printf("No members found matching the search criteria.\n");
+    FILE *file = fopen(tf->checksum_filename, "wb");
+    if(file == NULL) {
+        return 0;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for(int b = 0; b < blocks && ok; b++) {
+        int first = b * CRC_BLOCK_RECORDS;
+        int n = count - first < CRC_BLOCK_RECORDS ? count - first : CRC_BLOCK_RECORDS;
+        uint32_t crc = crc32c(0, (char*)tf->records + (size_t)first * tf->record_size,
+                              (size_t)n * tf->record_size);
+        ok = fwrite(&crc, sizeof(crc), 1, file) == 1;
     }
+    ok = fflush(file) == 0 && fsync(fileno(file)) == 0 && ok;
+    fclose(file);
+    return ok;
 }
 
-// Function to update a member
-void updateMember() {
-    system("clear || cls");
-    printHeader("UPDATE MEMBER");
-    
-    int id;
-    printf("Enter Member ID to update: ");
-    scanf("%d", &id);
-    clearInputBuffer();
-    
-    int index = findMemberById(id);
-    if(index == -1) {
-        printf("Member not found!\n");
-        return;
+// Helper function to recompute the checksums of the touched blocks by
+// reading them back from the data file, so the writer thread never reads
+// records the interactive thread may be changing
+int updateChecksums(int data_fd, TableFile* tf, int count, const unsigned char* touched) {
+    int fd = open(tf->checksum_filename, O_RDWR | O_CREAT, 0644);
+    if(fd < 0) {
+        return 0;
     }
     
-    printf("\nCurrent Details:\n");
-    printf("Name: %s\n", members[index].name);
-    printf("Email: %s\n", members[index].email);
-    printf("Phone: %s\n", members[index].phone);
-    printf("Books Issued: %d\n", members[index].books_issued);
-    
-    printf("\nEnter new details (press Enter to keep current value):\n");
+    int blocks = (count + CRC_BLOCK_RECORDS - 1) / CRC_BLOCK_RECORDS;
+    ChecksumHeader header = {CRC_MAGIC, tf->record_size, count, CRC_BLOCK_RECORDS};
+    int ok = pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
     
-    printf("Name [%s]: ", members[index].name);
-    char temp[100];
-    fgets(temp, 100, stdin);
-    temp[strcspn(temp, "\n")] = 0;
-    if(strlen(temp) > 0) {
-        strcpy(members[index].name, temp);
+    char* block = malloc(CRC_BLOCK_RECORDS * tf->record_size);
+    ok = ok && block != NULL;
+    for(int b = 0; b < blocks && ok; b++) {
+        if(!touched[b]) continue;
+        int first = b * CRC_BLOCK_RECORDS;
+        int n = count - first < CRC_BLOCK_RECORDS ? count - first : CRC_BLOCK_RECORDS;
+        ssize_t length = (ssize_t)n * tf->record_size;
+        if(pread(data_fd, block, length, (off_t)first * tf->record_size) != length) {
+            ok = 0;
+            break;
+        }
+        uint32_t crc = crc32c(0, block, length);
+        off_t offset = sizeof(header) + (off_t)b * sizeof(uint32_t);
+        ok = pwrite(fd, &crc, sizeof(crc), offset) == sizeof(crc);
     }
+    free(block);
     
-    printf("Email [%s]: ", members[index].email);
-    fgets(temp, 100, stdin);
-    temp[strcspn(temp, "\n")] = 0;
-    if(strlen(temp) > 0) {
-        strcpy(members[index].email, temp);
+    if(ftruncate(fd, sizeof(header) + (off_t)blocks * sizeof(uint32_t)) != 0 || fsync(fd) != 0) {
+        ok = 0;
     }
-    
-    printf("Phone [%s]: ", members[index].phone);
-    fgets(temp, 100, stdin);
-    temp[strcspn(temp, "\n")] = 0;
-    if(strlen(temp) > 0) {
-        strcpy(members[index].phone, temp);
+    close(fd);
+    return ok;
+}
+
+// Helper function to mark one record as changed since the last save
+void markDirty(int table, int index) {
+    TableFile* tf = &table_files[table];
+    table_versions[table]++;
+    if(!tf->dirty[index]) {
+        tf->dirty[index] = 1;
+        tf->dirty_list[tf->dirty_count++] = index;
     }
     
-    printf("\nMember updated successfully!\n");
+    // Also queue the record for the replication log
+    if(ship_pending_count < MAX_SHIP_PENDING) {
+        ship_pending_table[ship_pending_count] = table;
+        ship_pending_index[ship_pending_count] = index;
+        ship_pending_count++;
+    } else {
+        ship_overflow = 1;
+    }
 }
 
-// Function to delete a member
-void deleteMember() {
-    system("clear || cls");
-    printHeader("DELETE MEMBER");
-    
-    int id;
-    printf("Enter Member ID to delete: ");
-    scanf("%d", &id);
-    clearInputBuffer();
-    
-    int index = findMemberById(id);
-    if(index == -1) {
-        printf("Member not found!\n");
+// Helper function to mark every record from index onwards as changed, for
+// deletions that shift the tail of a table down by one slot
+void markDirtyFrom(int table, int index) {
+    table_versions[table]++;    // also covers deleting the last record
+    for(int i = index; i < *table_files[table].count; i++) {
+        markDirty(table, i);
+    }
+}
+
+// Helper function to start a new replication log holding a full snapshot.
+// The log is built under a temporary name and renamed into place, so a
+// replica tailing the previous log notices the new file and starts over.
+// Also used to replace a log that has grown too large.
+void startShipping() {
+    if(!ensureHistoryLoaded()) {
+        printf("Warning: replicas will not be updated.\n");
+        return;
+    }
+    int fd = open(FILENAME_REPLICATION_LOG ".tmp", O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if(fd < 0) {
+        printf("Warning: cannot create %s; replicas will not be updated.\n", FILENAME_REPLICATION_LOG);
+        return;
+    }
+    if(rename(FILENAME_REPLICATION_LOG ".tmp", FILENAME_REPLICATION_LOG) != 0) {
+        close(fd);
+        return;
+    }
+    if(ship_fd >= 0) {
+        close(ship_fd);
+    }
+    ship_fd = fd;
+    ship_log_size = 0;
+    ship_pending_count = 0;
+    ship_overflow = 1;      // first shipment is the full snapshot
+    shipPendingMutations();
+}
+
+// Helper function to append everything changed since the last call to the
+// replication log with a single write(); no fsync, so circulation never
+// waits on the disk for a replica
+void shipPendingMutations() {
+    int changed = ship_pending_count > 0 || ship_overflow;
+    for(int t = 0; t < TABLE_COUNT; t++) {
+        if(*table_files[t].count != ship_shipped_count[t]) changed = 1;
+    }
+    if(ship_fd < 0 || !changed) {
+        ship_pending_count = 0;
         return;
     }
     
-    printf("\nMember Details:\n");
-    printf("Name: %s\n", members[index].name);
-    printf("Membership ID: %s\n", members[index].membership_id);
-    printf("Books Issued: %d\n", members[index].books_issued);
+    long size = 0;
+    long capacity = 0;
+    char* buffer = NULL;
+    int shipped[TABLE_COUNT] = {0};
+    int snapshot = ship_overflow;
     
-    if(members[index].books_issued > 0) {
-        printf("Cannot delete member! Some books are still issued.\n");
+    if(ship_overflow) {
+        // Too much changed to list: send a reset and every record
+        shipTable(&buffer, &size, &capacity, SHIP_RESET, -1);
+        for(int t = 0; t < TABLE_COUNT; t++) {
+            for(int i = 0; i < *table_files[t].count; i++) {
+                shipTable(&buffer, &size, &capacity, t, i);
+            }
+            shipped[t] = 1;
+        }
+    } else {
+        for(int p = 0; p < ship_pending_count; p++) {
+            int t = ship_pending_table[p];
+            if(ship_pending_index[p] < *table_files[t].count) {
+                shipTable(&buffer, &size, &capacity, t, ship_pending_index[p]);
+                shipped[t] = 1;
+            }
+        }
+    }
+    // Deleting a table's last record changes only its count
+    for(int t = 0; t < TABLE_COUNT; t++) {
+        if(!shipped[t] && *table_files[t].count != ship_shipped_count[t]) {
+            shipTable(&buffer, &size, &capacity, t, -1);
+        }
+        ship_shipped_count[t] = *table_files[t].count;
+    }
+    
+    if(buffer != NULL && write(ship_fd, buffer, size) != size) {
+        printf("Warning: replication log write failed; replicas may be stale.\n");
+    }
+    free(buffer);
+    ship_pending_count = 0;
+    ship_overflow = 0;
+    
+    // The log only grows, so once the changes in it outweigh a snapshot it
+    // is replaced by a fresh one; replicas follow the rename
+    ship_log_size += size;
+    if(snapshot) {
+        ship_snapshot_size = size;
+    } else if(ship_log_size > REPLICATION_LOG_LIMIT && ship_log_size > 2 * ship_snapshot_size) {
+        startShipping();
+    }
+}
+
+// Helper function to append one log entry for a record to a growing buffer
+void shipTable(char** buffer, long* size, long* capacity, int table, int index) {
+    size_t record_size = table == SHIP_RESET || index < 0 ? 0 : table_files[table].record_size;
+    long needed = *size + sizeof(ShipHeader) + record_size;
+    if(needed > *capacity) {
+        long grown = *capacity > 0 ? *capacity * 2 : 4096;
+        while(grown < needed) grown *= 2;
+        char* larger = realloc(*buffer, grown);
+        if(larger == NULL) return;
+        *buffer = larger;
+        *capacity = grown;
+    }
+    
+    ShipHeader header;
+    header.magic = SHIP_MAGIC;
+    header.table = table;
+    header.sequence = ++ship_sequence;
+    header.timestamp_us = wallClockMicros();
+    header.index = index;
+    header.count = table == SHIP_RESET ? 0 : *table_files[table].count;
+    memcpy(*buffer + *size, &header, sizeof(header));
+    if(record_size > 0) {
+        memcpy(*buffer + *size + sizeof(header),
+               (char*)table_files[table].records + (size_t)index * record_size, record_size);
+    }
+    *size = needed;
+}
+
+// Replica thread: tails the replication log and applies complete entries,
+// reopening it from the start whenever the primary begins a new log
+void* replicaTailer(void* arg) {
+    (void)arg;
+    int fd = -1;
+    ino_t inode = 0;
+    char* pending = NULL;
+    long pending_size = 0;
+    long pending_capacity = 0;
+    
+    for(;;) {
+        struct stat path_info;
+        if(stat(FILENAME_REPLICATION_LOG, &path_info) == 0 && (fd < 0 || path_info.st_ino != inode)) {
+            if(fd >= 0) close(fd);
+            fd = open(FILENAME_REPLICATION_LOG, O_RDONLY);
+            inode = path_info.st_ino;
+            pending_size = 0;
+        }
+        
+        if(fd >= 0) {
+            char chunk[65536];
+            ssize_t n;
+            while((n = read(fd, chunk, sizeof(chunk))) > 0) {
+                if(pending_size + n > pending_capacity) {
+                    long grown = pending_capacity > 0 ? pending_capacity * 2 : 65536;
+                    while(grown < pending_size + n) grown *= 2;
+                    char* larger = realloc(pending, grown);
+                    if(larger == NULL) break;
+                    pending = larger;
+                    pending_capacity = grown;
+                }
+                memcpy(pending + pending_size, chunk, n);
+                pending_size += n;
+            }
+            
+            pthread_mutex_lock(&replica_lock);
+            long used = applyShipped(pending, pending_size);
+            replica_bytes_behind = pending_size - used;
+            pthread_mutex_unlock(&replica_lock);
+            
+            // Keep a partial trailing entry for the next poll
+            memmove(pending, pending + used, pending_size - used);
+            pending_size -= used;
+        }
+        
+        struct timespec pause = {0, REPLICA_POLL_MS * 1000000L};
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+// Helper function to apply the complete log entries at the start of
+// buffer to the in-memory tables and their indexes. Returns the bytes used.
+long applyShipped(const char* buffer, long size) {
+    long pos = 0;
+    int books_changed = 0;
+    int holds_changed = 0;
+    
+    while(pos + (long)sizeof(ShipHeader) <= size) {
+        ShipHeader header;
+        memcpy(&header, buffer + pos, sizeof(header));
+        if(header.magic != SHIP_MAGIC) {
+            // Not an entry boundary: wait for the primary's next new log
+            pos = size;
+            break;
+        }
+        
+        if(header.table == SHIP_RESET) {
+            book_count = member_count = transaction_count = hold_count = 0;
+            replica_indexed_transactions = 0;
+            open_loan_count = 0;
+            for(int t = 0; t < TABLE_COUNT; t++) {
+                table_versions[t]++;
+            }
+            rebuildLoanHistory();
+            rebuildIssueDateIndex();
+            rebuildPopularity();
+            pos += sizeof(header);
+            books_changed = holds_changed = 1;
+        } else {
+            if(header.table >= TABLE_COUNT) {
+                pos = size;
+                break;
+            }
+            TableFile* tf = &table_files[header.table];
+            long length = sizeof(header) + (header.index >= 0 ? (long)tf->record_size : 0);
+            if(pos + length > size) {
+                break;
+            }
+            if(header.count > tf->capacity || header.index >= tf->capacity) {
+                pos += length;
+                continue;
+            }
+            
+            if(header.index >= 0) {
+                memcpy((char*)tf->records + (size_t)header.index * tf->record_size,
+                       buffer + pos + sizeof(header), tf->record_size);
+            }
+            *tf->count = header.count;
+            table_versions[header.table]++;
+            
+            if(header.table == TABLE_BOOKS && header.index >= 0) {
+                foldBookRecord(header.index);
+                books_changed = 1;
+            } else if(header.table == TABLE_BOOKS) {
+                books_changed = 1;
+            } else if(header.table == TABLE_TRANSACTIONS && header.index >= replica_indexed_transactions) {
+                // Transactions are append-only, so slots arrive in order
+                indexTransaction(header.index);
+                indexIssueDate(header.index);
+                recordLoan(header.index);
+                replica_indexed_transactions = header.index + 1;
+            } else if(header.table == TABLE_HOLDS) {
+                holds_changed = 1;
+            }
+            if(header.table == TABLE_TRANSACTIONS && header.index >= 0) {
+                setLoanOpen(header.index, !transactions[header.index].returned);
+            }
+            pos += length;
+        }
+        
+        replica_applied_sequence = header.sequence;
+        replica_last_lag_us = wallClockMicros() - header.timestamp_us;
+    }
+    
+    if(books_changed) {
+        fuzzy_index_dirty = 1;
+        rebuildIsbnFilter();
+    }
+    if(holds_changed) {
+        rebuildHoldQueues();
+    }
+    return pos;
+}
+
+// Helper function to read the wall clock in microseconds, comparable
+// between the primary and replica processes
+int64_t wallClockMicros() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// Helper function to tell which menu choices a replica may serve
+int isReadOnlyChoice(int choice) {
+    switch(choice) {
+        case 2: case 3: case 7: case 8: case 13: case 14: case 16: case 17:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Helper function to read a clock that only moves forward, for intervals
+int64_t monotonicMicros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// Function to start recording a circulation trace. The data files are
+// copied to <path>.start first, so the trace can be replayed from the
+// state it began in. Needs the full history for the starting digest.
+int startTrace(const char* path) {
+    char dir[MAX_PATH], dest[MAX_PATH];
+    snprintf(dir, sizeof(dir), "%s" TRACE_SNAPSHOT_SUFFIX, path);
+    if(!ensureHistoryLoaded() || (mkdir(dir, 0755) != 0 && errno != EEXIST)) {
+        fprintf(stderr, "Cannot snapshot the data files to %s!\n", dir);
+        return 0;
+    }
+    for(size_t i = 0; i < sizeof(trace_snapshot_files) / sizeof(trace_snapshot_files[0]); i++) {
+        snprintf(dest, sizeof(dest), "%s" TRACE_SNAPSHOT_SUFFIX "/%s", path, trace_snapshot_files[i]);
+        if(!copyFile(trace_snapshot_files[i], dest)) {
+            fprintf(stderr, "Cannot snapshot %s to %s!\n", trace_snapshot_files[i], dest);
+            return 0;
+        }
+    }
+    
+    trace_file = fopen(path, "wb");
+    if(trace_file == NULL) {
+        fprintf(stderr, "Cannot create trace file %s!\n", path);
+        return 0;
+    }
+    TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TRACE_MAGIC;
+    header.record_size = sizeof(TraceRecord);
+    header.start_us = trace_start_us = wallClockMicros();
+    trace_start_mono_us = monotonicMicros();
+    stateDigest(header.start_digest);
+    fwrite(&header, sizeof(header), 1, trace_file);
+    fflush(trace_file);
+    return 1;
+}
+
+// Function to close the trace with the final state, which a replay is
+// checked against
+void finishTrace() {
+    if(trace_file == NULL) {
+        return;
+    }
+    uint32_t digest[TABLE_COUNT];
+    if(ensureHistoryLoaded()) {
+        stateDigest(digest);
+        TraceRecord record;
+        memset(&record, 0, sizeof(record));
+        record.offset_us = monotonicMicros() - trace_start_mono_us;
+        record.op = TRACE_END;
+        record.length = sizeof(digest);
+        fwrite(&record, sizeof(record), 1, trace_file);
+        fwrite(digest, sizeof(digest), 1, trace_file);
+    }
+    fclose(trace_file);
+    trace_file = NULL;
+}
+
+// Helper function to append one operation to the trace. Records are
+// flushed as they are written, so a crash loses at most the final digests.
+void traceOperation(int op, LibraryStatus status, int id, int arg0, int arg1, int result,
+                    const char** texts, int text_count) {
+    if(trace_file == NULL) {
         return;
     }
+    char payload[MAX_TRACE_PAYLOAD];
+    size_t length = 0;
+    for(int t = 0; t < text_count; t++) {
+        size_t n = strlen(texts[t]) + 1;
+        if(length + n > sizeof(payload)) break;
+        memcpy(payload + length, texts[t], n);
+        length += n;
+    }
     
-    char confirm;
-    printf("Are you sure you want to delete this member? (y/n): ");
-    scanf("%c", &confirm);
-    clearInputBuffer();
+    TraceRecord record;
+    memset(&record, 0, sizeof(record));
+    record.offset_us = monotonicMicros() - trace_start_mono_us;
+    record.op = op;
+    record.status = status;
+    record.length = length;
+    record.id = id;
+    record.args[0] = arg0;
+    record.args[1] = arg1;
+    record.result = result;
+    fwrite(&record, sizeof(record), 1, trace_file);
+    fwrite(payload, 1, length, trace_file);
+    fflush(trace_file);
+}
+
+void traceBookInput(int op, LibraryStatus status, int id, const BookInput* input, int result) {
+    const char* texts[] = {input->title, input->author, input->isbn, input->category};
+    traceOperation(op, status, id, input->year, input->quantity, result, texts, 4);
+}
+
+void traceMemberInput(int op, LibraryStatus status, int id, const MemberInput* input, int result) {
+    const char* texts[] = {input->name, input->email, input->phone};
+    traceOperation(op, status, id, 0, 0, result, texts, 3);
+}
+
+// Helper function to fingerprint each table: the CRC32C of its rows as
+// the views print them, so bytes past a string's terminator do not count
+void stateDigest(uint32_t* digest) {
+    for(int table = 0; table < TABLE_COUNT; table++) {
+        char* text = NULL;
+        size_t length = 0;
+        FILE* out = open_memstream(&text, &length);
+        digest[table] = 0;
+        if(out == NULL) {
+            continue;
+        }
+        for(int i = 0; i < *table_files[table].count; i++) {
+            switch(table) {
+                case TABLE_BOOKS: printBookRow(out, &books[i]); break;
+                case TABLE_MEMBERS: printMemberRow(out, &members[i]); break;
+                case TABLE_TRANSACTIONS: printTransactionRow(out, &transactions[i]); break;
+                default:
+                    fprintf(out, "%d %d %d %s %s %d\n", holds[i].hold_id, holds[i].book_id,
+                            holds[i].member_id, holds[i].placed_date, holds[i].expires_date,
+                            holds[i].status);
+                    break;
+            }
+        }
+        fclose(out);
+        digest[table] = crc32c(0, text, length);
+        free(text);
+    }
+}
+
+// Helper function to copy a data file; a missing source removes dest
+int copyFile(const char* source, const char* dest) {
+    FILE* in = fopen(source, "rb");
+    if(in == NULL) {
+        return errno == ENOENT && (unlink(dest) == 0 || errno == ENOENT);
+    }
+    FILE* out = fopen(dest, "wb");
+    if(out == NULL) {
+        fclose(in);
+        return 0;
+    }
+    char buffer[65536];
+    size_t n;
+    int ok = 1;
+    while((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if(fwrite(buffer, 1, n, out) != n) {
+            ok = 0;
+            break;
+        }
+    }
+    ok = !ferror(in) && fclose(out) == 0 && ok;
+    fclose(in);
+    return ok;
+}
+
+// Function to replay a trace against a fresh copy of its starting files,
+// in a new replay.XXXXXX directory. The schedule is open-loop: operation
+// i is due at its recorded offset divided by speed (or at once when speed
+// is 0) whether or not earlier ones have finished, and its latency runs
+// from when it was due, so falling behind shows up in the tail. Returns 0
+// when the final state matches the recording, 2 when it diverged and 1 on
+// error.
+int replayTrace(const char* path, double speed) {
+    FILE* file = fopen(path, "rb");
+    if(file == NULL) {
+        fprintf(stderr, "Cannot open trace file %s!\n", path);
+        return 1;
+    }
+    TraceHeader header;
+    if(fread(&header, sizeof(header), 1, file) != 1 || header.magic != TRACE_MAGIC ||
+       header.record_size != sizeof(TraceRecord)) {
+        fprintf(stderr, "%s is not a circulation trace!\n", path);
+        fclose(file);
+        return 1;
+    }
     
-    if(confirm == 'y' || confirm == 'Y') {
-        for(int i = index; i < member_count - 1; i++) {
-            members[i] = members[i + 1];
+    // The whole trace is read up front so replay timing is not disk bound
+    int capacity = 1024, count = 0;
+    TraceRecord* records = malloc(sizeof(TraceRecord) * capacity);
+    char** payloads = malloc(sizeof(char*) * capacity);
+    uint32_t final_digest[TABLE_COUNT];
+    int has_final = 0;
+    TraceRecord record;
+    while(records != NULL && payloads != NULL && fread(&record, sizeof(record), 1, file) == 1) {
+        if(record.op == TRACE_END) {
+            has_final = record.length == sizeof(final_digest) &&
+                        fread(final_digest, sizeof(final_digest), 1, file) == 1;
+            break;
         }
-        member_count--;
-        printf("Member deleted successfully!\n");
+        if(count == capacity) {
+            capacity *= 2;
+            TraceRecord* grown = realloc(records, sizeof(TraceRecord) * capacity);
+            char** grown_payloads = grown != NULL ? realloc(payloads, sizeof(char*) * capacity) : NULL;
+            if(grown != NULL) records = grown;
+            if(grown_payloads == NULL) break;
+            payloads = grown_payloads;
+        }
+        payloads[count] = malloc(record.length + 1);
+        if(payloads[count] == NULL || fread(payloads[count], 1, record.length, file) != record.length) {
+            free(payloads[count]);
+            break;
+        }
+        payloads[count][record.length] = '\0';
+        records[count++] = record;
+    }
+    fclose(file);
+    
+    int64_t* latencies = records != NULL && payloads != NULL ? malloc(sizeof(int64_t) * (count + 1)) : NULL;
+    char dir[] = "replay.XXXXXX";
+    char source[MAX_PATH], dest[MAX_PATH];
+    int ok = latencies != NULL && mkdtemp(dir) != NULL;
+    for(size_t i = 0; ok && i < sizeof(trace_snapshot_files) / sizeof(trace_snapshot_files[0]); i++) {
+        snprintf(source, sizeof(source), "%s" TRACE_SNAPSHOT_SUFFIX "/%s", path, trace_snapshot_files[i]);
+        snprintf(dest, sizeof(dest), "%s/%s", dir, trace_snapshot_files[i]);
+        ok = copyFile(source, dest);
+    }
+    // Startup expires holds against today, so today is when the trace began
+    clock_override = (time_t)(header.start_us / 1000000);
+    char message[1024] = "";
+    ok = ok && chdir(dir) == 0 && loadData(message, sizeof(message)) && ensureHistoryLoaded();
+    if(!ok) {
+        fprintf(stderr, "Cannot prepare a copy of %s" TRACE_SNAPSHOT_SUFFIX " to replay against!\n%s", path, message);
+        for(int i = 0; i < count; i++) free(payloads[i]);
+        free(payloads);
+        free(records);
+        free(latencies);
+        return 1;
+    }
+    
+    uint32_t digest[TABLE_COUNT];
+    stateDigest(digest);
+    if(memcmp(digest, header.start_digest, sizeof(digest)) != 0) {
+        printf("Warning: the snapshot does not match the state the trace began in.\n");
+    }
+    startCheckpointWriter();
+    
+    if(speed > 0) {
+        printf("Replaying %d operation(s) from %s in %s at %gx...\n", count, path, dir, speed);
     } else {
-        printf("Deletion cancelled.\n");
+        printf("Replaying %d operation(s) from %s in %s at maximum speed...\n", count, path, dir);
+    }
+    int mismatched = 0;
+    int64_t begin = monotonicMicros();
+    for(int i = 0; i < count; i++) {
+        int64_t due = begin + (speed > 0 ? (int64_t)(records[i].offset_us / speed) : 0);
+        int64_t now = monotonicMicros();
+        if(now < due) {
+            struct timespec pause = {(due - now) / 1000000, ((due - now) % 1000000) * 1000};
+            nanosleep(&pause, NULL);
+        }
+        if(speed <= 0) {
+            due = monotonicMicros();
+        }
+        clock_override = (time_t)((header.start_us + records[i].offset_us) / 1000000);
+        int result = 0;
+        int status = replayOperation(&records[i], payloads[i], &result);
+        latencies[i] = monotonicMicros() - due;
+        if(status != records[i].status || result != records[i].result) {
+            if(mismatched++ < 5) {
+                printf("  #%d %s: recorded %s (%d), replayed %s (%d)\n", i + 1,
+                       trace_op_names[records[i].op <= TRACE_QUERY ? records[i].op : 0],
+                       libraryStatusText(records[i].status), records[i].result,
+                       libraryStatusText(status), result);
+            }
+        }
     }
+    int64_t elapsed = monotonicMicros() - begin;
+    saveData();
+    stopCheckpointWriter();
+    
+    qsort(latencies, count, sizeof(int64_t), compareLatency);
+    double seconds = elapsed > 0 ? elapsed / 1e6 : 1e-6;
+    printf("\nOperations: %d in %.3f s (recorded over %.3f s)\n", count, elapsed / 1e6,
+           count > 0 ? records[count - 1].offset_us / 1e6 : 0.0);
+    printf("Throughput: %.1f ops/s\n", count / seconds);
+    if(count > 0) {
+        printf("Latency (us): p50 %lld  p90 %lld  p99 %lld  p99.9 %lld  max %lld\n",
+               (long long)latencies[(count - 1) * 50 / 100],
+               (long long)latencies[(count - 1) * 90 / 100],
+               (long long)latencies[(count - 1) * 99 / 100],
+               (long long)latencies[(int)((count - 1) * 999LL / 1000)],
+               (long long)latencies[count - 1]);
+    }
+    printf("Outcomes differing from the recording: %d\n", mismatched);
+    
+    int diverged = mismatched > 0;
+    if(has_final) {
+        const char* names[TABLE_COUNT] = {"books", "members", "transactions", "holds"};
+        stateDigest(digest);
+        for(int table = 0; table < TABLE_COUNT; table++) {
+            int same = digest[table] == final_digest[table];
+            diverged |= !same;
+            printf("Final %s: %s\n", names[table], same ? "matches" : "DIVERGED");
+        }
+    } else {
+        printf("The trace has no final state (the recording did not exit cleanly).\n");
+    }
+    printf("The replayed files are kept in %s.\n", dir);
+    
+    for(int i = 0; i < count; i++) free(payloads[i]);
+    free(payloads);
+    free(records);
+    free(latencies);
+    return checkpoint_failed ? 1 : diverged ? 2 : 0;
 }
 
-// Function to issue a book
-void issueBook() {
+// Helper function to run one traced operation through the same core calls
+// the menu uses. Sets result to the value the recorder kept.
+int replayOperation(const TraceRecord* record, const char* payload, int* result) {
+    const char* cursor = payload;
+    const char* end = payload + record->length;
+    BookInput book;
+    MemberInput member;
+    if(record->op == TRACE_ADD_BOOK || record->op == TRACE_UPDATE_BOOK) {
+        copyText(book.title, nextTraceText(&cursor, end), MAX_TITLE);
+        copyText(book.author, nextTraceText(&cursor, end), MAX_AUTHOR);
+        copyText(book.isbn, nextTraceText(&cursor, end), sizeof(book.isbn));
+        copyText(book.category, nextTraceText(&cursor, end), sizeof(book.category));
+        book.year = record->args[0];
+        book.quantity = record->args[1];
+    } else if(record->op == TRACE_ADD_MEMBER || record->op == TRACE_UPDATE_MEMBER) {
+        copyText(member.name, nextTraceText(&cursor, end), MAX_NAME);
+        copyText(member.email, nextTraceText(&cursor, end), sizeof(member.email));
+        copyText(member.phone, nextTraceText(&cursor, end), sizeof(member.phone));
+    }
+    
+    int book_index = findBookById(record->id);
+    int member_index = findMemberById(record->op == TRACE_ISSUE ? record->args[0] : record->id);
+    if(record->op == TRACE_SEARCH_BOOK || record->op == TRACE_SEARCH_MEMBER || record->op == TRACE_FUZZY_SEARCH ||
+       record->op == TRACE_QUERY || record->op == TRACE_CANCEL_HOLD) {
+        book_index = member_index = -1;     // id is not a book or member here
+    }
+    switch(record->op) {
+        case TRACE_SEARCH_BOOK: {
+            static Book results[MAX_BOOKS];
+            *result = librarySearchBooks(record->args[0], payload, results, MAX_BOOKS);
+            return LIB_OK;
+        }
+        case TRACE_SEARCH_MEMBER:
+            for(int i = 0; i < member_count; i++) {
+                *result += memberMatchesField(record->args[0], &members[i], payload);
+            }
+            return LIB_OK;
+        case TRACE_ADD_BOOK:
+            return addBookRecord(&book, result);
+        case TRACE_UPDATE_BOOK:
+            return book_index == -1 ? LIB_NOT_FOUND : updateBookRecord(book_index, &book);
+        case TRACE_DELETE_BOOK:
+            return book_index == -1 ? LIB_NOT_FOUND : deleteBookRecord(book_index);
+        case TRACE_ADD_MEMBER:
+            return addMemberRecord(&member, result);
+        case TRACE_UPDATE_MEMBER:
+            return member_index == -1 ? LIB_NOT_FOUND : updateMemberRecord(member_index, &member);
+        case TRACE_DELETE_MEMBER:
+            return member_index == -1 ? LIB_NOT_FOUND : deleteMemberRecord(member_index);
+        case TRACE_ISSUE:
+            if(book_index == -1 || member_index == -1) {
+                return LIB_NOT_FOUND;
+            }
+            return issueLoan(book_index, member_index, result);
+        case TRACE_PLACE_HOLD:
+            return book_index == -1 ? LIB_NOT_FOUND : placeHoldRecord(book_index, record->args[0], result);
+        case TRACE_CANCEL_HOLD:
+            return cancelHoldRecord(record->id);
+        case TRACE_FUZZY_SEARCH: {
+            static int best_index[MAX_BOOKS];
+            static int best_distance[MAX_BOOKS];
+            int found = fuzzyMatchBooks(payload, record->args[0], record->args[1], best_index, best_distance);
+            *result = found < 0 ? 0 : found;
+            return found < 0 ? LIB_INVALID : LIB_OK;
+        }
+        case TRACE_QUERY: {
+            Query query;
+            char text[MAX_TRACE_PAYLOAD];
+            int scanned;
+            copyText(text, payload, sizeof(text));
+            query.table = record->args[0];
+            if(!parseQuery(text, &query)) {
+                return LIB_INVALID;
+            }
+            *result = runQuery(&query, NULL, &scanned);
+            return LIB_OK;
+        }
+        case TRACE_RETURN: {
+            int slot = findOpenLoan(record->id);
+            if(slot == -1) {
+                return LIB_NOT_FOUND;
+            }
+            return returnLoan(slot, findBookById(transactions[slot].book_id),
+                              findMemberById(transactions[slot].member_id), result, NULL);
+        }
+    }
+    return LIB_INVALID;
+}
+
+// Helper function to take the next terminated text field of a payload
+const char* nextTraceText(const char** cursor, const char* end) {
+    if(*cursor >= end) {
+        return "";
+    }
+    const char* text = *cursor;
+    *cursor += strlen(text) + 1;
+    return text;
+}
+
+int compareLatency(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Function to add a new book
+void addBook() {
     system("clear || cls");
-    printHeader("ISSUE BOOK");
+    printHeader("ADD NEW BOOK");
     
-    int book_id, member_id;
+    if(book_count >= MAX_BOOKS) {
+        printf("Book storage is full!\n");
+        return;
+    }
     
-    printf("Enter Book ID: ");
-    scanf("%d", &book_id);
-    clearInputBuffer();
+    BookInput input;
     
-    int book_index = findBookById(book_id);
-    if(book_index == -1) {
-        printf("Book not found!\n");
+    printf("Enter Book Details:\n");
+    printf("===================\n");
+    
+    printf("Title: ");
+    fgets(input.title, MAX_TITLE, stdin);
+    input.title[strcspn(input.title, "\n")] = 0;
+    
+    printf("Author: ");
+    fgets(input.author, MAX_AUTHOR, stdin);
+    input.author[strcspn(input.author, "\n")] = 0;
+    
+    do {
+        printf("ISBN (13 digits): ");
+        fgets(input.isbn, 14, stdin);
+        input.isbn[strcspn(input.isbn, "\n")] = 0;
+        
+        if(!isISBNValid(input.isbn)) {
+            printf("Invalid ISBN format! Please enter 13 digits.\n");
+        }
+    } while(!isISBNValid(input.isbn));
+    
+    int existing = findBookByISBN(input.isbn);
+    if(existing != -1) {
+        printf("A book with this ISBN already exists (ID %d). Update its quantity instead.\n",
+               books[existing].id);
         return;
     }
     
-    if(books[book_index].available <= 0) {
-        printf("Book not available! All copies are issued.\n");
+    printf("Publication Year: ");
+    scanf("%d", &input.year);
+    clearInputBuffer();
+    
+    printf("Category: ");
+    fgets(input.category, 30, stdin);
+    input.category[strcspn(input.category, "\n")] = 0;
+    
+    printf("Total Quantity: ");
+    scanf("%d", &input.quantity);
+    clearInputBuffer();
+    
+    int id = 0;
+    LibraryStatus status = addBookRecord(&input, &id);
+    traceBookInput(TRACE_ADD_BOOK, status, 0, &input, id);
+    if(status != LIB_OK) {
+        printf("Cannot add the book: %s!\n", libraryStatusText(status));
         return;
     }
     
-    printf("Enter Member ID: ");
-    scanf("%d", &member_id);
+    printf("\nBook added successfully! Book ID: %d\n", id);
+}
+
+// Function to view all books
+void viewBooks() {
+    browseTable(TABLE_BOOKS, "VIEW ALL BOOKS", "No books found!");
+}
+
+// Function to search for a book
+void searchBook() {
+    system("clear || cls");
+    printHeader("SEARCH BOOK");
+    
+    int choice;
+    printf("Search by:\n");
+    printf("1. Book ID\n");
+    printf("2. ISBN\n");
+    printf("3. Title\n");
+    printf("4. Author\n");
+    printf("5. Category\n");
+    printf("6. Fuzzy Title/Author (typo tolerant)\n");
+    printf("7. All Branches (query)\n");
+    printf("Enter choice: ");
+    promptNumber(&choice);
     clearInputBuffer();
     
-    int member_index = findMemberById(member_id);
-    if(member_index == -1) {
-        printf("Member not found!\n");
+    if(choice == 6) {
+        fuzzySearchBooks();
         return;
     }
-    
-    if(members[member_index].books_issued >= 5) {
-        printf("Member has reached maximum issue limit (5 books)!\n");
+    if(choice == 7) {
+        crossBranchSearch();
         return;
     }
-    
-    // Create transaction
-    Transaction newTransaction;
-    newTransaction.transaction_id = transaction_count > 0 ? transactions[transaction_count-1].transaction_id + 1 : 3001;
-    newTransaction.book_id = book_id;
-    newTransaction.member_id = member_id;
-    getCurrentDate(newTransaction.issue_date);
-    addDays(newTransaction.issue_date, newTransaction.due_date, 14); // 14 days due
-    newTransaction.return_date[0] = '\0';
-    newTransaction.returned = 0;
-    
-    // Update book and member
-    books[book_index].available--;
-    members[member_index].books_issued++;
-    
-    // Add transaction
-    transactions[transaction_count++] = newTransaction;
-    
-    printf("\nBook issued successfully!\n");
-    printf("Transaction ID: %d\n", newTransaction.transaction_id);
-    printf("Book: %s\n", books[book_index].title);
-    printf("Member: %s\n", members[member_index].name);
-    printf("Issue Date: %s\n", newTransaction.issue_date);
-    printf("Due Date: %s\n", newTransaction.due_date);
+    
+    char searchTerm[100];
+    printf("Enter search term: ");
+    promptLine(searchTerm, 100);
+    searchTerm[strcspn(searchTerm, "\n")] = 0;
+    
+    printf("\nSearch Results:\n");
+    printf("%-5s %-30s %-20s %-13s %-8s %-10s %-10s %-15s\n", 
+           "ID", "Title", "Author", "ISBN", "Year", "Quantity", "Available", "Category");
+    printf("--------------------------------------------------------------------------------------------------------\n");
+    
+    static Book results[MAX_BOOKS];
+    int found = librarySearchBooks(choice, searchTerm, results, MAX_BOOKS);
+    const char* texts[] = {searchTerm};
+    traceOperation(TRACE_SEARCH_BOOK, LIB_OK, 0, choice, 0, found, texts, 1);
+    for(int i = 0; i < found; i++) {
+        printf("%-5d %-30s %-20s %-13s %-8d %-10d %-10d %-15s\n",
+               results[i].id,
+               results[i].title,
+               results[i].author,
+               results[i].ISBN,
+               results[i].year,
+               results[i].quantity,
+               results[i].available,
+               results[i].category);
+    }
+    
+    if(!found) {
+        printf("No books found matching the search criteria.\n");
+    }
+}
+
+// Function to search books in every branch in parallel and merge the
+// matches, tagged with their branch
+void crossBranchSearch() {
+    Query query;
+    query.table = QUERY_TABLE_BOOKS;
+    printf("\nEnter conditions, e.g. author~Tolkien available>0\n");
+    printf("Query: ");
+    char text[512];
+    promptLine(text, 512);
+    text[strcspn(text, "\n")] = 0;
+    if(!parseQuery(text, &query)) {
+        return;
+    }
+    
+    static BranchScan scans[MAX_BRANCHES];
+    int branch_count = scanBranches(&query, scans);
+    if(branch_count == 0) {
+        printf("No branches found under %s.\n", branch_root);
+        return;
+    }
+    
+    printf("\nSearch Results:\n");
+    printf("%-12s ", "Branch");
+    printBookHeader(stdout);
+    int shown = 0;
+    for(int b = 0; b < branch_count; b++) {
+        if(scans[b].error[0]) {
+            printf("%-12s (skipped: %s)\n", scans[b].name, scans[b].error);
+            continue;
+        }
+        for(int i = 0; i < scans[b].match_count; i++) {
+            if(query.limit >= 0 && shown >= query.limit) break;
+            printf("%-12s ", scans[b].name);
+            printBookRow(stdout, &scans[b].matches[i]);
+            shown++;
+        }
+        free(scans[b].matches);
+    }
+    if(shown == 0) {
+        printf("No books found matching the search criteria.\n");
+    }
+}
+
+// Function to report collection and circulation totals per branch
+void crossBranchSummary() {
+    static BranchScan scans[MAX_BRANCHES];
+    int branch_count = scanBranches(NULL, scans);
+    
+    system("clear || cls");
+    printHeader("CROSS-BRANCH SUMMARY");
+    if(branch_count == 0) {
+        printf("No branches found under %s.\n", branch_root);
+        return;
+    }
+    
+    printf("%-15s %-8s %-8s %-10s %-8s %-10s\n", "Branch", "Titles", "Copies", "Available", "Members", "On Loan");
+    printf("---------------------------------------------------------------\n");
+    BranchScan total = {0};
+    for(int b = 0; b < branch_count; b++) {
+        if(scans[b].error[0]) {
+            printf("%-15s (skipped: %s)\n", scans[b].name, scans[b].error);
+            continue;
+        }
+        printf("%-15s %-8d %-8d %-10d %-8d %-10d\n", scans[b].name, scans[b].books, scans[b].copies,
+               scans[b].available, scans[b].members, scans[b].open_loans);
+        total.books += scans[b].books;
+        total.copies += scans[b].copies;
+        total.available += scans[b].available;
+        total.members += scans[b].members;
+        total.open_loans += scans[b].open_loans;
+    }
+    printf("---------------------------------------------------------------\n");
+    printf("%-15s %-8d %-8d %-10d %-8d %-10d\n", "All branches", total.books, total.copies,
+           total.available, total.members, total.open_loans);
+}
+
+// Function to run a typo-tolerant search over titles and authors
+void fuzzySearchBooks() {
+    char searchTerm[100];
+    printf("Enter search term: ");
+    promptLine(searchTerm, 100);
+    searchTerm[strcspn(searchTerm, "\n")] = 0;
+    
+    char temp[20];
+    int max_distance = 2;
+    printf("Max typos allowed [%d]: ", max_distance);
+    promptLine(temp, 20);
+    if(strlen(temp) > 1) {
+        max_distance = atoi(temp);
+    }
+    
+    int top_k = FUZZY_DEFAULT_TOP_K;
+    printf("Max results [%d]: ", top_k);
+    promptLine(temp, 20);
+    if(strlen(temp) > 1) {
+        top_k = atoi(temp);
+    }
+    
+    static int best_index[MAX_BOOKS];
+    static int best_distance[MAX_BOOKS];
+    int best_count = fuzzyMatchBooks(searchTerm, max_distance, top_k, best_index, best_distance);
+    const char* texts[] = {searchTerm};
+    traceOperation(TRACE_FUZZY_SEARCH, best_count < 0 ? LIB_INVALID : LIB_OK, 0, max_distance, top_k,
+                   best_count < 0 ? 0 : best_count, texts, 1);
+    if(best_count < 0) {
+        printf("Invalid search parameters!\n");
+        return;
+    }
+    
+    printf("\nSearch Results:\n");
+    printf("%-5s %-30s %-20s %-13s %-8s %-10s %-10s %-6s\n", 
+           "ID", "Title", "Author", "ISBN", "Year", "Quantity", "Available", "Typos");
+    printf("--------------------------------------------------------------------------------------------------------\n");
+    
+    for(int i = 0; i < best_count; i++) {
+        Book* b = &books[best_index[i]];
+        printf("%-5d %-30s %-20s %-13s %-8d %-10d %-10d %-6d\n",
+               b->id,
+               b->title,
+               b->author,
+               b->ISBN,
+               b->year,
+               b->quantity,
+               b->available,
+               best_distance[i]);
+    }
+    
+    if(best_count == 0) {
+        printf("No books found within %d typos.\n", max_distance);
+    }
+}
+
+// Helper function to find the top_k books whose title or author is within
+// max_distance edits of term, best first, into best_index/best_distance
+// (MAX_BOOKS entries each). Returns the number found, or -1 for invalid
+// parameters.
+int fuzzyMatchBooks(const char* term, int max_distance, int top_k, int* best_index, int* best_distance) {
+    // Fold the pattern once and build its match masks for the Myers kernel
+    char pattern[FUZZY_MAX_PATTERN + 1];
+    int m = 0;
+    for(int i = 0; term[i] && m < FUZZY_MAX_PATTERN; i++) {
+        pattern[m++] = tolower((unsigned char)term[i]);
+    }
+    pattern[m] = '\0';
+    
+    if(m == 0 || max_distance < 0 || top_k <= 0) {
+        return -1;
+    }
+    
+    uint64_t peq[256] = {0};
+    for(int i = 0; i < m; i++) {
+        peq[(unsigned char)pattern[i]] |= 1ULL << i;
+    }
+    
+    if(fuzzy_index_dirty) {
+        rebuildFuzzyIndex();
+    }
+    
+    // q-gram lemma: a substring within k edits of the pattern shares at
+    // least (m - q + 1 - k*q) of the pattern's q-grams, so only records
+    // reaching that count need the exact distance computed. Trigrams give
+    // no bound below m = 3k + 3 (9 letters at the default 2 typos), so
+    // shorter patterns use the bigram index, which bounds down to m = 2k + 2
+    static int gram_hits[MAX_BOOKS];
+    static int candidates[MAX_BOOKS];
+    int candidate_count = 0;
+    int q = FUZZY_GRAM;
+    const int* bucket_start = fuzzy_bucket_start;
+    const int* postings = fuzzy_postings;
+    int threshold = m - q + 1 - max_distance * q;
+    if(threshold <= 0) {
+        q = FUZZY_SHORT_GRAM;
+        bucket_start = fuzzy_bigram_start;
+        postings = fuzzy_bigram_postings;
+        threshold = m - q + 1 - max_distance * q;
+    }
+    
+    if(threshold > 0) {
+        memset(gram_hits, 0, sizeof(int) * book_count);
+        for(int i = 0; i + q <= m; i++) {
+            uint32_t h = 0;
+            for(int j = 0; j < q; j++) {
+                h = h * 31 + (unsigned char)pattern[i + j];
+            }
+            h %= FUZZY_BUCKETS;
+            for(int p = bucket_start[h]; p < bucket_start[h + 1]; p++) {
+                int rec = postings[p];
+                if(++gram_hits[rec] == threshold) {
+                    candidates[candidate_count++] = rec;
+                }
+            }
+        }
+    } else {
+        for(int i = 0; i < book_count; i++) {
+            candidates[candidate_count++] = i;
+        }
+    }
+    
+    // Verify candidates and keep the best top_k by distance (insertion into
+    // a small sorted buffer; top_k is expected to be tiny)
+    int best_count = 0;
+    if(top_k > MAX_BOOKS) {
+        top_k = MAX_BOOKS;
+    }
+    
+    for(int c = 0; c < candidate_count; c++) {
+        int rec = candidates[c];
+        int d = fuzzyDistance(peq, m, book_title_fold[rec]);
+        int d_author = fuzzyDistance(peq, m, book_author_fold[rec]);
+        if(d_author < d) {
+            d = d_author;
+        }
+        if(d > max_distance) {
+            continue;
+        }
+        if(best_count == top_k && d >= best_distance[best_count - 1]) {
+            continue;
+        }
+        
+        int pos = best_count < top_k ? best_count++ : best_count - 1;
+        while(pos > 0 && (best_distance[pos - 1] > d ||
+                          (best_distance[pos - 1] == d && best_index[pos - 1] > rec))) {
+            best_distance[pos] = best_distance[pos - 1];
+            best_index[pos] = best_index[pos - 1];
+            pos--;
+        }
+        best_distance[pos] = d;
+        best_index[pos] = rec;
+    }
+    
+    return best_count;
+}
+
+// Function to update a book
+void updateBook() {
+    system("clear || cls");
+    printHeader("UPDATE BOOK");
+    
+    int id;
+    printf("Enter Book ID to update: ");
+    scanf("%d", &id);
+    clearInputBuffer();
+    
+    int index = findBookById(id);
+    if(index == -1) {
+        traceOperation(TRACE_UPDATE_BOOK, LIB_NOT_FOUND, id, 0, 0, 0, NULL, 0);
+        printf("Book not found!\n");
+        return;
+    }
+    
+    printf("\nCurrent Details:\n");
+    printf("Title: %s\n", books[index].title);
+    printf("Author: %s\n", books[index].author);
+    printf("ISBN: %s\n", books[index].ISBN);
+    printf("Year: %d\n", books[index].year);
+    printf("Category: %s\n", books[index].category);
+    printf("Quantity: %d\n", books[index].quantity);
+    printf("Available: %d\n", books[index].available);
+    
+    printf("\nEnter new details (press Enter to keep current value):\n");
+    
+    BookInput input = {"", "", "", -1, "", -1};
+    char temp[100];
+    
+    printf("Title [%s]: ", books[index].title);
+    fgets(temp, 100, stdin);
+    temp[strcspn(temp, "\n")] = 0;
+    copyText(input.title, temp, MAX_TITLE);
+    
+    printf("Author [%s]: ", books[index].author);
+    fgets(temp, 100, stdin);
+    temp[strcspn(temp, "\n")] = 0;
+    copyText(input.author, temp, MAX_AUTHOR);
+    
+    printf("Category [%s]: ", books[index].category);
+    fgets(temp, 100, stdin);
+    temp[strcspn(temp, "\n")] = 0;
+    copyText(input.category, temp, sizeof(input.category));
+    
+    printf("Year [%d]: ", books[index].year);
+    fgets(temp, 100, stdin);
+    temp[strcspn(temp, "\n")] = 0;
+    if(strlen(temp) > 0) {
+        input.year = atoi(temp);
+    }
+    
+    printf("Total Quantity [%d]: ", books[index].quantity);
+    fgets(temp, 100, stdin);
+    temp[strcspn(temp, "\n")] = 0;
+    if(strlen(temp) > 0) {
+        input.quantity = atoi(temp);
+    }
+    
+    LibraryStatus status = updateBookRecord(index, &input);
+    traceBookInput(TRACE_UPDATE_BOOK, status, id, &input, 0);
+    if(status != LIB_OK) {
+        printf("Cannot update the book: %s!\n", libraryStatusText(status));
+        return;
+    }
+    
+    printf("\nBook updated successfully!\n");
+}
+
+// Function to delete a book
+void deleteBook() {
+    system("clear || cls");
+    printHeader("DELETE BOOK");
+    
+    int id;
+    printf("Enter Book ID to delete: ");
+    scanf("%d", &id);
+    clearInputBuffer();
+    
+    int index = findBookById(id);
+    if(index == -1) {
+        traceOperation(TRACE_DELETE_BOOK, LIB_NOT_FOUND, id, 0, 0, 0, NULL, 0);
+        printf("Book not found!\n");
+        return;
+    }
+    
+    printf("\nBook Details:\n");
+    printf("Title: %s\n", books[index].title);
+    printf("Author: %s\n", books[index].author);
+    printf("ISBN: %s\n", books[index].ISBN);
+    
+    if(books[index].available != books[index].quantity) {
+        printf("Cannot delete book! Some copies are still issued.\n");
+        return;
+    }
+    
+    char confirm;
+    printf("Are you sure you want to delete this book? (y/n): ");
+    scanf("%c", &confirm);
+    clearInputBuffer();
+    
+    if(confirm == 'y' || confirm == 'Y') {
+        traceOperation(TRACE_DELETE_BOOK, deleteBookRecord(index), id, 0, 0, 0, NULL, 0);
+        printf("Book deleted successfully!\n");
+    } else {
+        printf("Deletion cancelled.\n");
+    }
+}
+
+// Function to add a new member
+void addMember() {
+    system("clear || cls");
+    printHeader("ADD NEW MEMBER");
+    
+    if(member_count >= MAX_MEMBERS) {
+        printf("Member storage is full!\n");
+        return;
+    }
+    
+    MemberInput input;
+    
+    printf("Enter Member Details:\n");
+    printf("=====================\n");
+    
+    printf("Name: ");
+    fgets(input.name, MAX_NAME, stdin);
+    input.name[strcspn(input.name, "\n")] = 0;
+    
+    printf("Email: ");
+    fgets(input.email, 50, stdin);
+    input.email[strcspn(input.email, "\n")] = 0;
+    
+    printf("Phone: ");
+    fgets(input.phone, 15, stdin);
+    input.phone[strcspn(input.phone, "\n")] = 0;
+    
+    int id = 0;
+    LibraryStatus status = addMemberRecord(&input, &id);
+    traceMemberInput(TRACE_ADD_MEMBER, status, 0, &input, id);
+    if(status != LIB_OK) {
+        printf("Cannot add the member: %s!\n", libraryStatusText(status));
+        return;
+    }
+    
+    printf("\nMember added successfully!\n");
+    printf("Member ID: %d\n", id);
+    printf("Membership ID: %s\n", members[member_count - 1].membership_id);
+}
+
+// Function to view all members
+void viewMembers() {
+    browseTable(TABLE_MEMBERS, "VIEW ALL MEMBERS", "No members found!");
+}
+
+// Function to search for a member
+void searchMember() {
+    system("clear || cls");
+    printHeader("SEARCH MEMBER");
+    
+    int choice;
+    printf("Search by:\n");
+    printf("1. Member ID\n");
+    printf("2. Membership ID\n");
+    printf("3. Name\n");
+    printf("4. Email\n");
+    printf("Enter choice: ");
+    promptNumber(&choice);
+    clearInputBuffer();
+    
+    char searchTerm[100];
+    printf("Enter search term: ");
+    promptLine(searchTerm, 100);
+    searchTerm[strcspn(searchTerm, "\n")] = 0;
+    
+    printf("\nSearch Results:\n");
+    printf("%-5s %-20s %-15s %-25s %-15s %-10s %-15s\n", 
+           "ID", "Name", "Membership ID", "Email", "Phone", "Issued", "Join Date");
+    printf("--------------------------------------------------------------------------------------------------\n");
+    
+    int found = 0;
+    for(int i = 0; i < member_count; i++) {
+        if(memberMatchesField(choice, &members[i], searchTerm)) {
+            found++;
+            printf("%-5d %-20s %-15s %-25s %-15s %-10d %-15s\n",
+                   members[i].id,
+                   members[i].name,
+                   members[i].membership_id,
+                   members[i].email,
+                   members[i].phone,
+                   members[i].books_issued,
+                   members[i].join_date);
+        }
+    }
+    
+    const char* texts[] = {searchTerm};
+    traceOperation(TRACE_SEARCH_MEMBER, LIB_OK, 0, choice, 0, found, texts, 1);
+    
+    if(!found) {
+        printf("No members found matching the search criteria.\n");
+    }
+}
+
+// Function to update a member
+void updateMember() {
+    system("clear || cls");
+    printHeader("UPDATE MEMBER");
+    
+    int id;
+    printf("Enter Member ID to update: ");
+    scanf("%d", &id);
+    clearInputBuffer();
+    
+    int index = findMemberById(id);
+    if(index == -1) {
+        traceOperation(TRACE_UPDATE_MEMBER, LIB_NOT_FOUND, id, 0, 0, 0, NULL, 0);
+        printf("Member not found!\n");
+        return;
+    }
+    
+    printf("\nCurrent Details:\n");
+    printf("Name: %s\n", members[index].name);
+    printf("Email: %s\n", members[index].email);
+    printf("Phone: %s\n", members[index].phone);
+    printf("Books Issued: %d\n", members[index].books_issued);
+    
+    printf("\nEnter new details (press Enter to keep current value):\n");
+    
+    MemberInput input;
+    char temp[100];
+    
+    printf("Name [%s]: ", members[index].name);
+    fgets(temp, 100, stdin);
+    temp[strcspn(temp, "\n")] = 0;
+    copyText(input.name, temp, MAX_NAME);
+    
+    printf("Email [%s]: ", members[index].email);
+    fgets(temp, 100, stdin);
+    temp[strcspn(temp, "\n")] = 0;
+    copyText(input.email, temp, sizeof(input.email));
+    
+    printf("Phone [%s]: ", members[index].phone);
+    fgets(temp, 100, stdin);
+    temp[strcspn(temp, "\n")] = 0;
+    copyText(input.phone, temp, sizeof(input.phone));
+    
+    traceMemberInput(TRACE_UPDATE_MEMBER, updateMemberRecord(index, &input), id, &input, 0);
+    
+    printf("\nMember updated successfully!\n");
+}
+
+// Function to delete a member
+void deleteMember() {
+    system("clear || cls");
+    printHeader("DELETE MEMBER");
+    
+    int id;
+    printf("Enter Member ID to delete: ");
+    scanf("%d", &id);
+    clearInputBuffer();
+    
+    int index = findMemberById(id);
+    if(index == -1) {
+        traceOperation(TRACE_DELETE_MEMBER, LIB_NOT_FOUND, id, 0, 0, 0, NULL, 0);
+        printf("Member not found!\n");
+        return;
+    }
+    
+    printf("\nMember Details:\n");
+    printf("Name: %s\n", members[index].name);
+    printf("Membership ID: %s\n", members[index].membership_id);
+    printf("Books Issued: %d\n", members[index].books_issued);
+    
+    if(members[index].books_issued > 0) {
+        printf("Cannot delete member! Some books are still issued.\n");
+        return;
+    }
+    
+    char confirm;
+    printf("Are you sure you want to delete this member? (y/n): ");
+    scanf("%c", &confirm);
+    clearInputBuffer();
+    
+    if(confirm == 'y' || confirm == 'Y') {
+        traceOperation(TRACE_DELETE_MEMBER, deleteMemberRecord(index), id, 0, 0, 0, NULL, 0);
+        printf("Member deleted successfully!\n");
+    } else {
+        printf("Deletion cancelled.\n");
+    }
+}
+
+// Function to issue a book
+void issueBook() {
+    system("clear || cls");
+    printHeader("ISSUE BOOK");
+    
+    int book_id, member_id;
+    
+    printf("Enter Book ID: ");
+    scanf("%d", &book_id);
+    clearInputBuffer();
+    
+    int book_index = findBookById(book_id);
+    if(book_index == -1) {
+        traceOperation(TRACE_ISSUE, LIB_NOT_FOUND, book_id, 0, 0, 0, NULL, 0);
+        printf("Book not found!\n");
+        return;
+    }
+    
+    sweepExpiredHolds();
+    HoldQueue* queue = findHoldQueue(book_id, 0);
+    int ready_holds = queue != NULL ? queue->ready : 0;
+    
+    if(books[book_index].available <= 0 && ready_holds == 0) {
+        printf("Book not available! All copies are issued.\n");
+        char confirm;
+        printf("Place a hold for a member? (y/n): ");
+        scanf("%c", &confirm);
+        clearInputBuffer();
+        if(confirm == 'y' || confirm == 'Y') {
+            printf("Enter Member ID: ");
+            scanf("%d", &member_id);
+            clearInputBuffer();
+            placeHold(book_index, member_id);
+        }
+        return;
+    }
+    
+    printf("Enter Member ID: ");
+    scanf("%d", &member_id);
+    clearInputBuffer();
+    
+    int member_index = findMemberById(member_id);
+    if(member_index == -1) {
+        traceOperation(TRACE_ISSUE, LIB_NOT_FOUND, book_id, member_id, 0, 0, NULL, 0);
+        printf("Member not found!\n");
+        return;
+    }
+    
+    int transaction_id = 0;
+    LibraryStatus status = issueLoan(book_index, member_index, &transaction_id);
+    traceOperation(TRACE_ISSUE, status, book_id, member_id, 0, transaction_id, NULL, 0);
+    if(status == LIB_UNAVAILABLE) {
+        printf("Book not available! Remaining copies are held for other members.\n");
+        return;
+    }
+    if(status == LIB_LIMIT_REACHED) {
+        printf("Member has reached maximum issue limit (5 books)!\n");
+        return;
+    }
+    if(status != LIB_OK) {
+        printf("Cannot issue the book: %s!\n", libraryStatusText(status));
+        return;
+    }
+    Transaction newTransaction = transactions[findOpenLoan(transaction_id)];
+    
+    printf("\nBook issued successfully!\n");
+    printf("Transaction ID: %d\n", newTransaction.transaction_id);
+    printf("Book: %s\n", books[book_index].title);
+    printf("Member: %s\n", members[member_index].name);
+    printf("Issue Date: %s\n", newTransaction.issue_date);
+    printf("Due Date: %s\n", newTransaction.due_date);
+}
+
+// Function to return a book
+void returnBook() {
+    system("clear || cls");
+    printHeader("RETURN BOOK");
+    
+    int transaction_id;
+    printf("Enter Transaction ID: ");
+    scanf("%d", &transaction_id);
+    clearInputBuffer();
+    
+    int slot = findOpenLoan(transaction_id);
+    if(slot == -1) {
+        traceOperation(TRACE_RETURN, LIB_NOT_FOUND, transaction_id, 0, 0, 0, NULL, 0);
+        printf("Transaction not found or book already returned!\n");
+        return;
+    }
+    
+    // The copy goes straight to the next holder, if any
+    int book_index = findBookById(transactions[slot].book_id);
+    int next_holder;
+    int fine_cents;
+    LibraryStatus status = returnLoan(slot, book_index, findMemberById(transactions[slot].member_id),
+                                      &fine_cents, &next_holder);
+    traceOperation(TRACE_RETURN, status, transaction_id, 0, 0, fine_cents, NULL, 0);
+    
+    printf("\nBook returned successfully!\n");
+    printf("Transaction ID: %d\n", transactions[slot].transaction_id);
+    printf("Return Date: %s\n", transactions[slot].return_date);
+    
+    if(next_holder != -1) {
+        printf("Copy set aside for Member %d (hold %d) until %s.\n",
+               holds[next_holder].member_id,
+               holds[next_holder].hold_id,
+               holds[next_holder].expires_date);
+    }
+    
+    if(fine_cents > 0) {
+        printf("Overdue by %d days\n", fine_cents / FINE_CENTS_PER_DAY);
+        printf("Fine: $%.2f\n", fine_cents / 100.0);
+    } else {
+        printf("Returned on time. No fine.\n");
+    }
+}
+
+// Helper function to add a book to the catalogue. The menu and the library
+// API share it; the caller commits.
+LibraryStatus addBookRecord(const BookInput* input, int* book_id) {
+    if(book_count >= MAX_BOOKS) {
+        return LIB_FULL;
+    }
+    if(!isISBNValid(input->isbn) || input->quantity < 0) {
+        return LIB_INVALID;
+    }
+    if(findBookByISBN(input->isbn) != -1) {
+        return LIB_DUPLICATE;
+    }
+    
+    Book newBook;
+    newBook.id = book_count > 0 ? books[book_count-1].id + 1 : 1001;
+    copyText(newBook.title, input->title, MAX_TITLE);
+    copyText(newBook.author, input->author, MAX_AUTHOR);
+    copyText(newBook.ISBN, input->isbn, sizeof(newBook.ISBN));
+    copyText(newBook.category, input->category, sizeof(newBook.category));
+    newBook.year = input->year;
+    newBook.quantity = input->quantity;
+    newBook.available = newBook.quantity;
+    
+    books[book_count] = newBook;
+    foldBookRecord(book_count);
+    markDirty(TABLE_BOOKS, book_count);
+    book_count++;
+    fuzzy_index_dirty = 1;
+    // The filter is resized once the books outgrow it
+    if(isbnFilterBlocksFor(book_count) != isbn_filter_blocks) {
+        rebuildIsbnFilter();
+    } else {
+        isbnFilterAdd(newBook.ISBN);
+    }
+    
+    if(book_id != NULL) {
+        *book_id = newBook.id;
+    }
+    return LIB_OK;
+}
+
+// Helper function to apply a BookInput to books[index]; empty strings and
+// negative numbers keep the current value
+LibraryStatus updateBookRecord(int index, const BookInput* input) {
+    Book* book = &books[index];
+    if(input->isbn[0]) {
+        int existing = findBookByISBN(input->isbn);
+        if(!isISBNValid(input->isbn)) {
+            return LIB_INVALID;
+        }
+        if(existing != -1 && existing != index) {
+            return LIB_DUPLICATE;
+        }
+    }
+    
+    if(input->title[0]) copyText(book->title, input->title, MAX_TITLE);
+    if(input->author[0]) copyText(book->author, input->author, MAX_AUTHOR);
+    if(input->category[0]) copyText(book->category, input->category, sizeof(book->category));
+    if(input->year >= 0) book->year = input->year;
+    if(input->quantity >= 0) {
+        int diff = input->quantity - book->quantity;
+        book->quantity = input->quantity;
+        book->available += diff;
+    }
+    if(input->isbn[0] && strcmp(book->ISBN, input->isbn) != 0) {
+        copyText(book->ISBN, input->isbn, sizeof(book->ISBN));
+        rebuildIsbnFilter();
+    }
+    
+    foldBookRecord(index);
+    fuzzy_index_dirty = 1;
+    markDirty(TABLE_BOOKS, index);
+    
+    // New copies go to waiting holders first
+    handOffCopies(index);
+    return LIB_OK;
+}
+
+// Helper function to remove books[index] and cancel its waiting holds
+LibraryStatus deleteBookRecord(int index) {
+    if(books[index].available != books[index].quantity) {
+        return LIB_IN_USE;
+    }
+    
+    // Waiting holds can never be filled now
+    HoldQueue* queue = findHoldQueue(books[index].id, 0);
+    while(queue != NULL && queue->head != -1) {
+        int slot = queue->head;
+        unlinkHold(slot);
+        holds[slot].status = HOLD_CANCELLED;
+        markDirty(TABLE_HOLDS, slot);
+    }
+    
+    for(int i = index; i < book_count - 1; i++) {
+        books[i] = books[i + 1];
+        strcpy(book_title_fold[i], book_title_fold[i + 1]);
+        strcpy(book_author_fold[i], book_author_fold[i + 1]);
+    }
+    book_count--;
+    fuzzy_index_dirty = 1;
+    rebuildIsbnFilter();
+    markDirtyFrom(TABLE_BOOKS, index);
+    return LIB_OK;
+}
+
+// Helper function to enrol a member, generating the membership ID
+LibraryStatus addMemberRecord(const MemberInput* input, int* member_id) {
+    if(member_count >= MAX_MEMBERS) {
+        return LIB_FULL;
+    }
+    
+    Member newMember;
+    newMember.id = member_count > 0 ? members[member_count-1].id + 1 : 2001;
+    copyText(newMember.name, input->name, MAX_NAME);
+    sprintf(newMember.membership_id, "MEM%04d", newMember.id);
+    copyText(newMember.email, input->email, sizeof(newMember.email));
+    copyText(newMember.phone, input->phone, sizeof(newMember.phone));
+    newMember.books_issued = 0;
+    getCurrentDate(newMember.join_date);
+    
+    markDirty(TABLE_MEMBERS, member_count);
+    members[member_count++] = newMember;
+    
+    if(member_id != NULL) {
+        *member_id = newMember.id;
+    }
+    return LIB_OK;
+}
+
+// Helper function to apply a MemberInput to members[index]; empty strings
+// keep the current value
+LibraryStatus updateMemberRecord(int index, const MemberInput* input) {
+    Member* member = &members[index];
+    if(input->name[0]) copyText(member->name, input->name, MAX_NAME);
+    if(input->email[0]) copyText(member->email, input->email, sizeof(member->email));
+    if(input->phone[0]) copyText(member->phone, input->phone, sizeof(member->phone));
+    markDirty(TABLE_MEMBERS, index);
+    return LIB_OK;
+}
+
+// Helper function to remove members[index]
+LibraryStatus deleteMemberRecord(int index) {
+    if(members[index].books_issued > 0) {
+        return LIB_IN_USE;
+    }
+    for(int i = index; i < member_count - 1; i++) {
+        members[i] = members[i + 1];
+    }
+    member_count--;
+    markDirtyFrom(TABLE_MEMBERS, index);
+    return LIB_OK;
+}
+
+// Helper function to lend books[book_index] to members[member_index]. A
+// copy set aside for this member by a hold is used first; otherwise one
+// must be on the shelf.
+LibraryStatus issueLoan(int book_index, int member_index, int* transaction_id) {
+    Book* book = &books[book_index];
+    Member* member = &members[member_index];
+    
+    // A copy set aside for this member is already off the shelf
+    sweepExpiredHolds();
+    int hold_slot = findReadyHold(book->id, member->id);
+    if(hold_slot == -1 && book->available <= 0) {
+        return LIB_UNAVAILABLE;
+    }
+    if(member->books_issued >= 5) {
+        return LIB_LIMIT_REACHED;
+    }
+    if(transaction_count >= MAX_BOOKS * 10) {
+        return LIB_FULL;
+    }
+    
+    // Create transaction
+    Transaction newTransaction;
+    newTransaction.transaction_id = transaction_count > 0 ? transactions[transaction_count-1].transaction_id + 1 : 3001;
+    newTransaction.book_id = book->id;
+    newTransaction.member_id = member->id;
+    getCurrentDate(newTransaction.issue_date);
+    addDays(newTransaction.issue_date, newTransaction.due_date, 14); // 14 days due
+    newTransaction.return_date[0] = '\0';
+    newTransaction.returned = 0;
+    
+    // Update book and member
+    if(hold_slot != -1) {
+        unlinkHold(hold_slot);
+        holds[hold_slot].status = HOLD_FULFILLED;
+        markDirty(TABLE_HOLDS, hold_slot);
+    } else {
+        book->available--;
+    }
+    member->books_issued++;
+    markDirty(TABLE_BOOKS, book_index);
+    markDirty(TABLE_MEMBERS, member_index);
+    
+    // Add transaction
+    markDirty(TABLE_TRANSACTIONS, transaction_count);
+    transactions[transaction_count] = newTransaction;
+    setLoanOpen(transaction_count, 1);
+    if(history_loaded) {
+        // Otherwise the indexes are built when the history is paged in
+        indexTransaction(transaction_count);
+        indexIssueDate(transaction_count);
+        recordLoan(transaction_count);
+    }
+    transaction_count++;
+    
+    if(transaction_id != NULL) {
+        *transaction_id = newTransaction.transaction_id;
+    }
+    return LIB_OK;
+}
+
+// Helper function to close the open loan in slot and hand the copy to the
+// next holder. book_index and member_index may be -1 for deleted records.
+// Sets fine_cents to the late fee owed and, if not NULL, hold_slot to the
+// hold the copy was set aside for (or -1).
+LibraryStatus returnLoan(int slot, int book_index, int member_index, int* fine_cents, int* hold_slot) {
+    // Update transaction
+    getCurrentDate(transactions[slot].return_date);
+    transactions[slot].returned = 1;
+    setLoanOpen(slot, 0);
+    markDirty(TABLE_TRANSACTIONS, slot);
+    
+    // Update book and member
+    if(book_index != -1) {
+        books[book_index].available++;
+        markDirty(TABLE_BOOKS, book_index);
+    }
+    if(member_index != -1) {
+        members[member_index].books_issued--;
+        markDirty(TABLE_MEMBERS, member_index);
+    }
+    
+    // Calculate fine if overdue
+    int days_overdue = dateDifference(transactions[slot].due_date, transactions[slot].return_date);
+    int fine = days_overdue > 0 ? days_overdue * FINE_CENTS_PER_DAY : 0;
+    chargeReturnFine(slot, fine);
+    if(fine_cents != NULL) {
+        *fine_cents = fine;
+    }
+    
+    int readied = -1;
+    if(book_index != -1) {
+        sweepExpiredHolds();
+        readied = handOffCopies(book_index);
+    }
+    if(hold_slot != NULL) {
+        *hold_slot = readied;
+    }
+    return LIB_OK;
+}
+
+// Helper function to find the slot of an open loan. Transaction ids grow
+// with their slots, so the ascending open-loan set is searched by halving.
+int findOpenLoan(int transaction_id) {
+    int low = 0, high = open_loan_count;
+    while(low < high) {
+        int mid = (low + high) / 2;
+        if(transactions[open_loans[mid]].transaction_id < transaction_id) low = mid + 1;
+        else high = mid;
+    }
+    if(low < open_loan_count && transactions[open_loans[low]].transaction_id == transaction_id) {
+        return open_loans[low];
+    }
+    return -1;
+}
+
+// Function to view transactions. Only the blocks behind the page shown are
+// read, so this does not wait for the full history to load.
+void viewTransactions() {
+    browseTable(TABLE_TRANSACTIONS, "VIEW TRANSACTIONS", "No transactions found!");
+}
+
+// Function to page through a table in id order. The tables are kept sorted
+// by id, so a page is a slice of the array and a jump is a binary search;
+// each page is formatted into one buffer and written at once, and costs
+// the same however long the table is. A table that fits on one page is
+// shown without the page prompt.
+void browseTable(int table, char* title, const char* empty_message) {
+    static char page_buffer[PAGE_BUFFER_SIZE];
+    TableFile* tf = &table_files[table];
+    int page_size = PAGE_SIZE_DEFAULT;
+    int first = 0;
+    const char* notice = NULL;     // shown under the next page
+    
+    while(1) {
+        system("clear || cls");
+        printHeader(title);
+        
+        int count = *tf->count;
+        if(count == 0) {
+            printf("%s\n", empty_message);
+            return;
+        }
+        if(first > count - page_size) {
+            first = count > page_size ? count - page_size : 0;
+        }
+        int end = first + page_size < count ? first + page_size : count;
+        if(table == TABLE_TRANSACTIONS && !history_loaded &&
+           !loadHistoryBlocks(first / CRC_BLOCK_RECORDS, (end + CRC_BLOCK_RECORDS - 1) / CRC_BLOCK_RECORDS)) {
+            return;
+        }
+        
+        FILE* page = fmemopen(page_buffer, sizeof(page_buffer), "w");
+        if(page == NULL) {
+            printf("Error: out of memory!\n");
+            return;
+        }
+        switch(table) {
+            case TABLE_BOOKS:
+                printBookHeader(page);
+                for(int i = first; i < end; i++) printBookRow(page, &books[i]);
+                break;
+            case TABLE_MEMBERS:
+                printMemberHeader(page);
+                for(int i = first; i < end; i++) printMemberRow(page, &members[i]);
+                break;
+            default:
+                printTransactionHeader(page);
+                for(int i = first; i < end; i++) printTransactionRow(page, &transactions[i]);
+                break;
+        }
+        if(count > page_size) {
+            fprintf(page, "\nRows %d-%d of %d\n", first + 1, end, count);
+        }
+        fflush(page);
+        long length = ftell(page);
+        fclose(page);
+        fwrite(page_buffer, 1, length, stdout);
+        fflush(stdout);
+        
+        if(count <= page_size) {
+            return;
+        }
+        if(notice != NULL) {
+            printf("\n%s\n", notice);
+            notice = NULL;
+        }
+        char input[20];
+        printf("\n[N]ext, [P]revious, [J]ump to ID, page [S]ize, Enter to finish: ");
+        if(promptLine(input, 20) == NULL) {
+            return;
+        }
+        switch(tolower((unsigned char)input[0])) {
+            case 'n':
+                if(end < count) first = end;
+                break;
+            case 'p':
+                first = first > page_size ? first - page_size : 0;
+                break;
+            case 'j': {
+                printf("Enter ID: ");
+                if(promptLine(input, 20) == NULL) {
+                    return;
+                }
+                int id;
+                if(!parseNumber(input, &id)) {
+                    notice = "Invalid ID! Enter a number.";
+                    break;
+                }
+                int position = findIdPosition(table, id);
+                if(position < 0) {
+                    return;
+                }
+                first = position;
+                break;
+            }
+            case 's': {
+                printf("Rows per page (1-%d): ", MAX_PAGE_SIZE);
+                if(promptLine(input, 20) == NULL) {
+                    return;
+                }
+                int size;
+                if(!parseNumber(input, &size) || size < 1 || size > MAX_PAGE_SIZE) {
+                    notice = "Invalid page size!";
+                    break;
+                }
+                page_size = size;
+                break;
+            }
+            default:
+                return;
+        }
+    }
+}
+
+// Helper function to parse a whole line as an int; surrounding spaces are
+// allowed, anything else makes it fail. Returns 1 on success.
+int parseNumber(const char* text, int* value) {
+    char* end;
+    errno = 0;
+    long number = strtol(text, &end, 10);
+    if(end == text || errno != 0 || number < INT_MIN || number > INT_MAX) {
+        return 0;
+    }
+    while(isspace((unsigned char)*end)) {
+        end++;
+    }
+    if(*end != '\0') {
+        return 0;
+    }
+    *value = (int)number;
+    return 1;
+}
+
+// Helper function to find the first row of a table whose id is at least
+// id. Every record starts with its id and rows are in id order, so this is
+// a binary search; for transactions each probe pages in only its own block.
+// Returns -1 if a block could not be read.
+int findIdPosition(int table, int id) {
+    TableFile* tf = &table_files[table];
+    int low = 0, high = *tf->count;
+    while(low < high) {
+        int mid = low + (high - low) / 2;
+        if(table == TABLE_TRANSACTIONS && !history_loaded &&
+           !loadHistoryBlocks(mid / CRC_BLOCK_RECORDS, mid / CRC_BLOCK_RECORDS + 1)) {
+            return -1;
+        }
+        int key;
+        memcpy(&key, (char*)tf->records + (size_t)mid * tf->record_size, sizeof(key));
+        if(key < id) low = mid + 1; else high = mid;
+    }
+    return low;
+}
+
+// Function to generate reports
+void generateReports() {
+    system("clear || cls");
+    printHeader("GENERATE REPORTS");
+    
+    int choice;
+    printf("1. Books Available\n");
+    printf("2. Books Issued\n");
+    printf("3. Overdue Books\n");
+    printf("4. Member Report\n");
+    printf("5. Category-wise Report\n");
+    printf("6. Loans Issued Between Dates\n");
+    printf("7. Monthly Circulation\n");
+    printf("8. Weekly Circulation\n");
+    printf("9. Accrue Fines (nightly batch)\n");
+    printf("10. Members Owing More Than...\n");
+    printf("11. Most Borrowed Titles and Authors\n");
+    printf("12. Cross-Branch Summary\n");
+    printf("(Report cache: %ld hits, %ld misses)\n", report_cache_hits, report_cache_misses);
+    printf("Enter choice: ");
+    promptNumber(&choice);
+    clearInputBuffer();
+    
+    switch(choice) {
+        case 1:
+        case 2:
+        case 3:
+        case 4:
+        case 5:
+            showCachedReport(choice);
+            break;
+        case 6:
+        case 7:
+        case 8:
+            circulationReport(choice);
+            break;
+        case 9:
+            if(replica_mode) {
+                printf("Run fine accrual on the primary.\n");
+                break;
+            }
+            accrueFines();
+            break;
+        case 10:
+            membersOwingReport();
+            break;
+        case 11:
+            popularityReport();
+            break;
+        case 12:
+            crossBranchSummary();
+            break;
+        default:
+            printf("Invalid choice!\n");
+    }
+}
+
+// Function to show one of reports 1-5. The rendered text is cached per
+// report and parameters, and reused until a table the report reads changes.
+void showCachedReport(int report) {
+    static char* titles[] = {NULL, "BOOKS AVAILABLE", "BOOKS CURRENTLY ISSUED", "OVERDUE BOOKS",
+                             "MEMBER REPORT", "CATEGORY-WISE BOOKS"};
+    system("clear || cls");
+    printHeader(titles[report]);
+    
+    // The overdue report also depends on today's date
+    char params[32] = "";
+    if(report == 3) {
+        getCurrentDate(params);
+    }
+    
+    ReportCacheEntry* entry = findCachedReport(report, params);
+    if(entry != NULL) {
+        report_cache_hits++;
+    } else {
+        report_cache_misses++;
+        char* text = NULL;
+        size_t length = 0;
+        FILE* out = open_memstream(&text, &length);
+        if(out == NULL) {
+            writeTableReport(report, stdout);
+            return;
+        }
+        writeTableReport(report, out);
+        fclose(out);
+        entry = storeCachedReport(report, params, text, length);
+    }
+    fwrite(entry->text, 1, entry->length, stdout);
+}
+
+// Helper function to render the body of one of reports 1-5 to out
+void writeTableReport(int report, FILE* out) {
+    switch(report) {
+        case 1: {
+            fprintf(out, "%-5s %-30s %-20s %-10s\n", "ID", "Title", "Author", "Available");
+            fprintf(out, "--------------------------------------------------------------\n");
+            for(int i = 0; i < book_count; i++) {
+                if(books[i].available > 0) {
+                    fprintf(out, "%-5d %-30s %-20s %-10d\n",
+                                 books[i].id,
+                                 books[i].title,
+                                 books[i].author,
+                                 books[i].available);
+                }
+            }
+            break;
+        }
+        case 2: {
+            fprintf(out, "%-5s %-30s %-8s %-12s %-12s\n", 
+                         "Book ID", "Title", "Member ID", "Issue Date", "Due Date");
+            fprintf(out, "-----------------------------------------------------------------\n");
+            for(int k = 0; k < open_loan_count; k++) {
+                int i = open_loans[k];
+                int book_index = findBookById(transactions[i].book_id);
+                if(book_index != -1) {
+                    fprintf(out, "%-5d %-30s %-8d %-12s %-12s\n",
+                                 transactions[i].book_id,
+                                 books[book_index].title,
+                                 transactions[i].member_id,
+                                 transactions[i].issue_date,
+                                 transactions[i].due_date);
+                }
+            }
+            break;
+        }
+        case 3: {
+            char current_date[11];
+            getCurrentDate(current_date);
+            
+            fprintf(out, "%-5s %-30s %-8s %-12s %-12s %-8s\n", 
+                         "Book ID", "Title", "Member ID", "Due Date", "Today", "Days Late");
+            fprintf(out, "--------------------------------------------------------------------------\n");
+            
+            int overdue_count = 0;
+            for(int k = 0; k < open_loan_count; k++) {
+                int i = open_loans[k];
+                int days_overdue = dateDifference(transactions[i].due_date, current_date);
+                if(days_overdue > 0) {
+                    int book_index = findBookById(transactions[i].book_id);
+                    if(book_index != -1) {
+                        fprintf(out, "%-5d %-30s %-8d %-12s %-12s %-8d\n",
+                                     transactions[i].book_id,
+                                     books[book_index].title,
+                                     transactions[i].member_id,
+                                     transactions[i].due_date,
+                                     current_date,
+                                     days_overdue);
+                        overdue_count++;
+                    }
+                }
+            }
+            if(overdue_count == 0) {
+                fprintf(out, "No overdue books!\n");
+            }
+            break;
+        }
+        case 4: {
+            fprintf(out, "%-5s %-20s %-15s %-10s\n", "ID", "Name", "Books Issued", "Join Date");
+            fprintf(out, "----------------------------------------------------\n");
+            for(int i = 0; i < member_count; i++) {
+                fprintf(out, "%-5d %-20s %-15d %-10s\n",
+                             members[i].id,
+                             members[i].name,
+                             members[i].books_issued,
+                             members[i].join_date);
+            }
+            break;
+        }
+        case 5: {
+            // Count books per category
+            char categories[100][30];
+            int category_count[100] = {0};
+            int unique_categories = 0;
+            
+            for(int i = 0; i < book_count; i++) {
+                int found = 0;
+                for(int j = 0; j < unique_categories; j++) {
+                    if(strcmp(categories[j], books[i].category) == 0) {
+                        category_count[j]++;
+                        found = 1;
+                        break;
+                    }
+                }
+                if(!found) {
+                    strcpy(categories[unique_categories], books[i].category);
+                    category_count[unique_categories] = 1;
+                    unique_categories++;
+                }
+            }
+            
+            fprintf(out, "%-20s %-10s\n", "Category", "Book Count");
+            fprintf(out, "------------------------------\n");
+            for(int i = 0; i < unique_categories; i++) {
+                fprintf(out, "%-20s %-10d\n", categories[i], category_count[i]);
+            }
+            break;
+        }
+    }
+}
+
+// Helper function to find a cached report that is still current
+ReportCacheEntry* findCachedReport(int report, const char* params) {
+    for(int e = 0; e < REPORT_CACHE_SLOTS; e++) {
+        ReportCacheEntry* entry = &report_cache[e];
+        if(entry->report != report || strcmp(entry->params, params) != 0) {
+            continue;
+        }
+        for(int t = 0; t < TABLE_COUNT; t++) {
+            if((report_tables[report] & (1 << t)) && entry->versions[t] != table_versions[t]) {
+                return NULL;
+            }
+        }
+        return entry;
+    }
+    return NULL;
+}
+
+// Helper function to cache a rendered report, taking ownership of text. A
+// stale entry for the same key is replaced; otherwise slots are reused in
+// turn.
+ReportCacheEntry* storeCachedReport(int report, const char* params, char* text, size_t length) {
+    ReportCacheEntry* entry = NULL;
+    for(int e = 0; e < REPORT_CACHE_SLOTS && entry == NULL; e++) {
+        if(report_cache[e].report == report && strcmp(report_cache[e].params, params) == 0) {
+            entry = &report_cache[e];
+        }
+    }
+    if(entry == NULL) {
+        entry = &report_cache[report_cache_next];
+        report_cache_next = (report_cache_next + 1) % REPORT_CACHE_SLOTS;
+    }
+    free(entry->text);
+    entry->report = report;
+    strncpy(entry->params, params, sizeof(entry->params) - 1);
+    entry->params[sizeof(entry->params) - 1] = '\0';
+    memcpy(entry->versions, table_versions, sizeof(table_versions));
+    entry->text = text;
+    entry->length = length;
+    return entry;
+}
+
+// Function to list or roll up loans issued in a date range. Mode 6 lists
+// the loans, 7 counts them per month, 8 per week (weeks start on Monday).
+// Only the index entries inside the range are visited.
+void circulationReport(int mode) {
+    if(!ensureHistoryLoaded()) {
+        return;
+    }
+    char start_date[20], end_date[20];
+    printf("Start date (YYYY-MM-DD): ");
+    promptLine(start_date, 20);
+    start_date[strcspn(start_date, "\n")] = 0;
+    printf("End date (YYYY-MM-DD): ");
+    promptLine(end_date, 20);
+    end_date[strcspn(end_date, "\n")] = 0;
+    
+    int start = parseDay(start_date);
+    int end = parseDay(end_date);
+    if(start == INVALID_DAY || end == INVALID_DAY || end < start) {
+        printf("Invalid date range!\n");
+        return;
+    }
+    
+    system("clear || cls");
+    printHeader(mode == 6 ? "LOANS ISSUED" : mode == 7 ? "MONTHLY CIRCULATION" : "WEEKLY CIRCULATION");
+    printf("From %s to %s\n\n", start_date, end_date);
+    
+    if(mode == 6) {
+        printTransactionHeader(stdout);
+    } else {
+        printf("%-12s %-10s %-10s\n", mode == 7 ? "Month" : "Week of", "Loans", "Returned");
+        printf("----------------------------------\n");
+    }
+    
+    int total = 0;
+    int group = -1;
+    int group_loans = 0;
+    int group_returned = 0;
+    for(int i = findFirstIssuedOnOrAfter(start); i < transaction_count; i++) {
+        int slot = issue_order[i];
+        int day = issue_day[slot];
+        if(day > end) {
+            break;
+        }
+        total++;
+        if(mode == 6) {
+            printTransactionRow(stdout, &transactions[slot]);
+            continue;
+        }
+        
+        // Rows arrive in date order, so each group is emitted once complete
+        char date[11];
+        formatDay(day, date);
+        int key = mode == 7 ? atoi(date) * 100 + atoi(date + 5) : day - (day + 3) % 7;
+        if(key != group && group != -1) {
+            printCirculationRow(mode, group, group_loans, group_returned);
+            group_loans = 0;
+            group_returned = 0;
+        }
+        group = key;
+        group_loans++;
+        group_returned += transactions[slot].returned;
+    }
+    if(group != -1) {
+        printCirculationRow(mode, group, group_loans, group_returned);
+    }
+    
+    printf("\nTotal loans: %d\n", total);
+}
+
+// Helper function to print one month (yyyymm) or week (day number of its
+// Monday) of a circulation rollup
+void printCirculationRow(int mode, int group, int loans, int returned) {
+    char label[16];
+    if(mode == 7) {
+        sprintf(label, "%04d-%02d", group / 100, group % 100);
+    } else {
+        formatDay(group, label);
+    }
+    printf("%-12s %-10d %-10d\n", label, loans, returned);
+}
+
+// Function to compute accrued fines on every open loan as of today and
+// persist the resulting per-member balances
+void accrueFines() {
+    system("clear || cls");
+    printHeader("ACCRUE FINES");
+    
+    char current_date[11];
+    getCurrentDate(current_date);
+    int today = parseDay(current_date);
+    clock_t started = clock();
+    
+    // Returned loans were charged when they came back, so only the open
+    // loans are visited and the history can stay on disk
+    accrueOpenLoans(today);
+    fines_as_of = today;
+    
+    long accrued_cents = 0;
+    long settled_cents = 0;
+    int overdue_loans = 0;
+    for(int k = 0; k < open_loan_count; k++) {
+        overdue_loans += accruedFine(open_loans[k], today) > 0;
+    }
+    for(int h = 0; h < HISTORY_SLOTS; h++) {
+        accrued_cents += member_fines[h].accrued_cents;
+        settled_cents += member_fines[h].settled_cents;
+    }
+    double elapsed_ms = (double)(clock() - started) * 1000.0 / CLOCKS_PER_SEC;
+    
+    printf("Loans scanned: %d\n", open_loan_count);
+    printf("Overdue loans: %d\n", overdue_loans);
+    printf("Accrued on open loans: $%.2f\n", accrued_cents / 100.0);
+    printf("Charged at return: $%.2f\n", settled_cents / 100.0);
+    printf("Outstanding fines: $%.2f\n", (accrued_cents + settled_cents) / 100.0);
+    printf("Computed in %.2f ms\n", elapsed_ms);
+    
+    if(saveFines()) {
+        fines_unsaved = 0;
+        printf("Balances saved to %s.\n", FILENAME_FINES);
+    } else {
+        printf("Error: could not save %s!\n", FILENAME_FINES);
+    }
+}
+
+// Function to list members whose accrued fines exceed an amount
+void membersOwingReport() {
+    char temp[20];
+    printf("Minimum balance ($): ");
+    promptLine(temp, 20);
+    int threshold = (int)(atof(temp) * 100 + 0.5);
+    
+    system("clear || cls");
+    printHeader("MEMBERS OWING FINES");
+    if(fines_as_of == -1) {
+        printf("Open loans have not been accrued yet (report 9); showing fees charged at return.\n\n");
+    } else {
+        char as_of[11];
+        formatDay(fines_as_of, as_of);
+        printf("Balances as of %s\n\n", as_of);
+    }
+    
+    printf("%-5s %-20s %-15s %-10s\n", "ID", "Name", "Membership ID", "Owes");
+    printf("----------------------------------------------------\n");
+    int found = 0;
+    for(int h = 0; h < HISTORY_SLOTS; h++) {
+        int owes = member_fines[h].settled_cents + member_fines[h].accrued_cents;
+        if(member_fines[h].member_id == 0 || owes <= threshold) {
+            continue;
+        }
+        int index = findMemberById(member_fines[h].member_id);
+        printf("%-5d %-20s %-15s $%-9.2f\n",
+               member_fines[h].member_id,
+               index != -1 ? members[index].name : "(deleted)",
+               index != -1 ? members[index].membership_id : "",
+               owes / 100.0);
+        found++;
+    }
+    if(!found) {
+        printf("No members owe more than $%.2f.\n", threshold / 100.0);
+    }
+}
+
+// Helper function to order heavy hitters by descending count
+int compareHitterCount(const void* a, const void* b) {
+    return ((const HeavyHitter*)b)->count - ((const HeavyHitter*)a)->count;
+}
+
+// Helper function to order heavy hitters by key so duplicates are adjacent
+int compareHitterKey(const void* a, const void* b) {
+    uint32_t ka = ((const HeavyHitter*)a)->key;
+    uint32_t kb = ((const HeavyHitter*)b)->key;
+    if(ka != kb) {
+        return (ka > kb) - (ka < kb);
+    }
+    // Authors whose hashes collide stay in separate runs
+    return compareAuthors(((const HeavyHitter*)a)->label, ((const HeavyHitter*)b)->label);
+}
+
+// Function to show the top-N titles and authors, either all-time from the
+// exact counters or for the last POPULARITY_WINDOW_DAYS days from the sketches
+void popularityReport() {
+    if(!ensureHistoryLoaded()) {
+        return;
+    }
+    int period, top_n;
+    printf("1. All Time (exact)\n");
+    printf("2. Last %d Days\n", POPULARITY_WINDOW_DAYS);
+    printf("Enter choice: ");
+    promptNumber(&period);
+    clearInputBuffer();
+    printf("How many (top N): ");
+    promptNumber(&top_n);
+    clearInputBuffer();
+    
+    if((period != 1 && period != 2) || top_n <= 0) {
+        printf("Invalid choice!\n");
+        return;
+    }
+    
+    static HeavyHitter merged[2][HISTORY_SLOTS];
+    int merged_count[2] = {0, 0};
+    
+    if(period == 1) {
+        for(int h = 0; h < HISTORY_SLOTS; h++) {
+            if(book_history[h].key != 0) {
+                HeavyHitter* e = &merged[0][merged_count[0]++];
+                int index = findBookById(book_history[h].key);
+                e->key = book_history[h].key;
+                e->count = book_history[h].count;
+                e->error = 0;
+                strcpy(e->label, index != -1 ? books[index].title : "(deleted)");
+            }
+            if(author_loans[h].key != 0) {
+                HeavyHitter* e = &merged[1][merged_count[1]++];
+                e->key = author_loans[h].key;
+                e->count = author_loans[h].count;
+                e->error = 0;
+                strcpy(e->label, author_loans[h].author);
+            }
+        }
+    } else {
+        // Merge the per-day sketches inside the window: sum counts and
+        // error bounds of equal keys
+        char current_date[11];
+        getCurrentDate(current_date);
+        int today = parseDay(current_date);
+        for(int d = 0; d < 2; d++) {
+            DaySketch* window = d == 0 ? title_window : author_window;
+            HeavyHitter* out = merged[d];
+            int n = 0;
+            for(int w = 0; w < POPULARITY_WINDOW_DAYS; w++) {
+                if(window[w].size == 0 || window[w].day <= today - POPULARITY_WINDOW_DAYS ||
+                   window[w].day > today) {
+                    continue;
+                }
+                memcpy(out + n, window[w].counters, window[w].size * sizeof(HeavyHitter));
+                n += window[w].size;
+            }
+            qsort(out, n, sizeof(HeavyHitter), compareHitterKey);
+            int unique = 0;
+            for(int i = 0; i < n; i++) {
+                if(unique > 0 && out[unique - 1].key == out[i].key &&
+                   (d == 0 || compareAuthors(out[unique - 1].label, out[i].label) == 0)) {
+                    out[unique - 1].count += out[i].count;
+                    out[unique - 1].error += out[i].error;
+                } else {
+                    out[unique++] = out[i];
+                }
+            }
+            merged_count[d] = unique;
+        }
+    }
+    
+    system("clear || cls");
+    printHeader(period == 1 ? "MOST BORROWED (ALL TIME)" : "MOST BORROWED (RECENT)");
+    for(int d = 0; d < 2; d++) {
+        qsort(merged[d], merged_count[d], sizeof(HeavyHitter), compareHitterCount);
+        printf("\n%-5s %-40s %-8s %-8s\n", "Rank", d == 0 ? "Title" : "Author", "Loans", "At least");
+        printf("----------------------------------------------------------------\n");
+        for(int i = 0; i < merged_count[d] && i < top_n; i++) {
+            printf("%-5d %-40.40s %-8d %-8d\n", i + 1, merged[d][i].label,
+                   merged[d][i].count, merged[d][i].count - merged[d][i].error);
+        }
+        if(merged_count[d] == 0) {
+            printf("No loans recorded.\n");
+        }
+    }
+}
+
+// Function to place, cancel and list holds
+void manageHolds() {
+    system("clear || cls");
+    printHeader("HOLDS / RESERVATIONS");
+    
+    int choice;
+    printf("1. Place Hold\n");
+    printf("2. Cancel Hold\n");
+    printf("3. View Holds on a Book\n");
+    printf("Enter choice: ");
+    scanf("%d", &choice);
+    clearInputBuffer();
+    
+    sweepExpiredHolds();
+    
+    if(choice == 1) {
+        int book_id, member_id;
+        printf("Enter Book ID: ");
+        scanf("%d", &book_id);
+        clearInputBuffer();
+        int book_index = findBookById(book_id);
+        if(book_index == -1) {
+            traceOperation(TRACE_PLACE_HOLD, LIB_NOT_FOUND, book_id, 0, 0, 0, NULL, 0);
+            printf("Book not found!\n");
+            return;
+        }
+        printf("Enter Member ID: ");
+        scanf("%d", &member_id);
+        clearInputBuffer();
+        placeHold(book_index, member_id);
+    } else if(choice == 2) {
+        int hold_id;
+        printf("Enter Hold ID: ");
+        scanf("%d", &hold_id);
+        clearInputBuffer();
+        
+        LibraryStatus status = cancelHoldRecord(hold_id);
+        traceOperation(TRACE_CANCEL_HOLD, status, hold_id, 0, 0, 0, NULL, 0);
+        if(status != LIB_OK) {
+            printf("Hold not found or no longer active!\n");
+            return;
+        }
+        printf("Hold cancelled.\n");
+    } else if(choice == 3) {
+        int book_id;
+        printf("Enter Book ID: ");
+        scanf("%d", &book_id);
+        clearInputBuffer();
+        HoldQueue* queue = findHoldQueue(book_id, 0);
+        if(queue == NULL || (queue->waiting == 0 && queue->ready == 0)) {
+            printf("No active holds on this book.\n");
+            return;
+        }
+        printf("\n%-8s %-10s %-12s %-12s %-8s\n", "Hold ID", "Member ID", "Placed", "Expires", "Status");
+        printf("------------------------------------------------------\n");
+        for(int list = 0; list < 2; list++) {
+            for(int slot = list == 0 ? queue->ready_head : queue->head; slot != -1; slot = hold_next[slot]) {
+                printf("%-8d %-10d %-12s %-12s %-8s\n",
+                       holds[slot].hold_id,
+                       holds[slot].member_id,
+                       holds[slot].placed_date,
+                       holds[slot].expires_date,
+                       list == 0 ? "Ready" : "Waiting");
+            }
+        }
+        printf("\n%d ready, %d waiting.\n", queue->ready, queue->waiting);
+    } else {
+        printf("Invalid choice!\n");
+    }
+}
+
+// Helper function to queue a hold for a member on a book with no copy on
+// the shelf
+void placeHold(int book_index, int member_id) {
+    int hold_id = 0;
+    LibraryStatus status = placeHoldRecord(book_index, member_id, &hold_id);
+    traceOperation(TRACE_PLACE_HOLD, status, books[book_index].id, member_id, 0, hold_id, NULL, 0);
+    if(status == LIB_NOT_FOUND) {
+        printf("Member not found!\n");
+        return;
+    }
+    if(status == LIB_INVALID) {
+        printf("A copy is available; issue it instead.\n");
+        return;
+    }
+    if(status == LIB_DUPLICATE) {
+        printf("Member already has a hold on this book!\n");
+        return;
+    }
+    if(status == LIB_FULL) {
+        printf("Hold storage is full!\n");
+        return;
+    }
+    
+    HoldQueue* queue = findHoldQueue(books[book_index].id, 0);
+    printf("\nHold placed! Hold ID: %d\n", hold_id);
+    printf("Position in queue: %d\n", queue->waiting);
+}
+
+// Helper function to queue a hold for a member on a book with no copy on
+// the shelf. The menu and trace replay share it. A member holds a book at
+// most once: LIB_DUPLICATE if they already wait for it or have a copy ready.
+LibraryStatus placeHoldRecord(int book_index, int member_id, int* hold_id) {
+    sweepExpiredHolds();
+    if(findMemberById(member_id) == -1) {
+        return LIB_NOT_FOUND;
+    }
+    if(books[book_index].available > 0) {
+        return LIB_INVALID;
+    }
+    HoldPair* pair = findHoldPair(books[book_index].id, member_id, 0);
+    if(pair != NULL && pair->active > 0) {
+        return LIB_DUPLICATE;
+    }
+    if(hold_count >= MAX_HOLDS) {
+        return LIB_FULL;
+    }
+    
+    Hold hold;
+    hold.hold_id = hold_count > 0 ? holds[hold_count-1].hold_id + 1 : 4001;
+    hold.book_id = books[book_index].id;
+    hold.member_id = member_id;
+    getCurrentDate(hold.placed_date);
+    addDays(hold.placed_date, hold.expires_date, HOLD_WAIT_DAYS);
+    hold.status = HOLD_WAITING;
+    
+    markDirty(TABLE_HOLDS, hold_count);
+    holds[hold_count] = hold;
+    linkHold(hold_count);
+    pushHoldDeadline(hold_count);
+    hold_count++;
+    
+    *hold_id = hold.hold_id;
+    return LIB_OK;
+}
+
+// Helper function to cancel an active hold; a copy set aside for it goes
+// to the next holder or back on the shelf
+LibraryStatus cancelHoldRecord(int hold_id) {
+    sweepExpiredHolds();
+    
+    // Hold ids are assigned in slot order
+    int slot = hold_count > 0 ? hold_id - holds[0].hold_id : -1;
+    if(slot < 0 || slot >= hold_count || holds[slot].hold_id != hold_id ||
+       (holds[slot].status != HOLD_WAITING && holds[slot].status != HOLD_READY)) {
+        return LIB_NOT_FOUND;
+    }
+    int was_ready = holds[slot].status == HOLD_READY;
+    unlinkHold(slot);
+    holds[slot].status = HOLD_CANCELLED;
+    markDirty(TABLE_HOLDS, slot);
+    if(was_ready) {
+        int book_index = findBookById(holds[slot].book_id);
+        if(book_index != -1) {
+            books[book_index].available++;
+            markDirty(TABLE_BOOKS, book_index);
+            handOffCopies(book_index);
+        }
+    }
+    return LIB_OK;
+}
+
+// Function to show the loan history of one member or one book
+void viewLoanHistory() {
+    system("clear || cls");
+    printHeader("LOAN HISTORY");
+    
+    if(!ensureHistoryLoaded()) {
+        return;
+    }
+    int choice;
+    printf("1. Loans of a Member\n");
+    printf("2. Borrowers of a Book\n");
+    printf("Enter choice: ");
+    promptNumber(&choice);
+    clearInputBuffer();
+    
+    if(choice != 1 && choice != 2) {
+        printf("Invalid choice!\n");
+        return;
+    }
+    
+    int id;
+    printf(choice == 1 ? "Enter Member ID: " : "Enter Book ID: ");
+    promptNumber(&id);
+    clearInputBuffer();
+    
+    HistoryList* history = findHistory(choice == 1 ? member_history : book_history, id, 0);
+    int* next = choice == 1 ? member_history_next : book_history_next;
+    
+    if(choice == 1) {
+        int index = findMemberById(id);
+        printf("\nMember: %s\n\n", index != -1 ? members[index].name : "(deleted)");
+    } else {
+        int index = findBookById(id);
+        printf("\nBook: %s\n\n", index != -1 ? books[index].title : "(deleted)");
+    }
+    
+    if(history == NULL) {
+        printf("No loans found!\n");
+        return;
+    }
+    
+    printTransactionHeader(stdout);
+    for(int t = history->head; t != -1; t = next[t]) {
+        printTransactionRow(stdout, &transactions[t]);
+    }
+    printf("\n%d loan(s).\n", history->count);
+}
+
+// Function to run a multi-predicate query against one table
+void queryRecords() {
+    system("clear || cls");
+    printHeader("QUERY RECORDS");
+    
+    Query query;
+    printf("Table:\n");
+    printf("1. Books\n");
+    printf("2. Members\n");
+    printf("3. Transactions\n");
+    printf("Enter choice: ");
+    promptNumber(&query.table);
+    clearInputBuffer();
+    
+    if(query.table < QUERY_TABLE_BOOKS || query.table > QUERY_TABLE_TRANSACTIONS) {
+        printf("Invalid choice!\n");
+        return;
+    }
+    if(query.table == QUERY_TABLE_TRANSACTIONS && !ensureHistoryLoaded()) {
+        return;
+    }
+    
+    printf("\nEnter conditions separated by spaces, e.g.\n");
+    printf("  author~Tolkien category=Fantasy year>2010 available>0 limit=10 offset=0\n");
+    printf("Operators: = != < <= > >= ~ (contains). Quote values with spaces.\n");
+    printf("Query: ");
+    char text[512];
+    promptLine(text, 512);
+    text[strcspn(text, "\n")] = 0;
+    
+    char traced[512];
+    copyText(traced, text, sizeof(traced));
+    if(!parseQuery(text, &query)) {
+        return;
+    }
+    
+    int total;
+    switch(query.table) {
+        case QUERY_TABLE_BOOKS: total = book_count; printBookHeader(stdout); break;
+        case QUERY_TABLE_MEMBERS: total = member_count; printMemberHeader(stdout); break;
+        default: total = transaction_count; printTransactionHeader(stdout); break;
+    }
+    int scanned;
+    int shown = runQuery(&query, stdout, &scanned);
+    const char* texts[] = {traced};
+    traceOperation(TRACE_QUERY, LIB_OK, 0, query.table, 0, shown, texts, 1);
+    
+    if(shown == 0) {
+        printf("No records found matching the query.\n");
+    } else {
+        printf("\n%d record(s) shown, %d of %d scanned.\n", shown, scanned, total);
+    }
+}
+
+// Helper function to run a parsed query, printing matching rows to out
+// (nothing when out is NULL). Returns the rows shown; scanned gets the
+// number of rows examined before the limit, if any, stopped the pass.
+int runQuery(Query* query, FILE* out, int* scanned) {
+    static int candidates[MAX_BOOKS * 10];
+    int candidate_count = planQuery(query, candidates);
+    int total = query->table == QUERY_TABLE_BOOKS ? book_count :
+                query->table == QUERY_TABLE_MEMBERS ? member_count : transaction_count;
+    
+    // Single pass: every predicate is checked once per candidate, with
+    // offset/limit applied as rows stream out
+    int considered = candidate_count >= 0 ? candidate_count : total;
+    int matched = 0;
+    int shown = 0;
+    int c;
+    for(c = 0; c < considered; c++) {
+        if(query->limit >= 0 && shown >= query->limit) {
+            break;
+        }
+        int i = candidate_count >= 0 ? candidates[c] : c;
+        const void* record;
+        switch(query->table) {
+            case QUERY_TABLE_BOOKS: record = &books[i]; break;
+            case QUERY_TABLE_MEMBERS: record = &members[i]; break;
+            default: record = &transactions[i]; break;
+        }
+        if(!matchRecord(record, query)) {
+            continue;
+        }
+        if(matched++ < query->offset) {
+            continue;
+        }
+        if(out != NULL) {
+            switch(query->table) {
+                case QUERY_TABLE_BOOKS: printBookRow(out, &books[i]); break;
+                case QUERY_TABLE_MEMBERS: printMemberRow(out, &members[i]); break;
+                default: printTransactionRow(out, &transactions[i]); break;
+            }
+        }
+        shown++;
+    }
+    
+    *scanned = c;
+    return shown;
+}
+
+// Helper function to parse "field<op>value ..." into a query; returns 0 on error
+int parseQuery(char* text, Query* query) {
+    const FieldDef* fields = query->table == QUERY_TABLE_BOOKS ? book_fields :
+                             query->table == QUERY_TABLE_MEMBERS ? member_fields :
+                             transaction_fields;
+    query->predicate_count = 0;
+    query->limit = -1;
+    query->offset = 0;
+    
+    char* p = text;
+    while(*p) {
+        while(*p == ' ') p++;
+        if(*p == '\0') break;
+        
+        // Field name runs up to the first operator character
+        char name[30];
+        int n = 0;
+        while(*p && !strchr("=!<>~ ", *p) && n < 29) {
+            name[n++] = tolower((unsigned char)*p++);
+        }
+        name[n] = '\0';
+        
+        PredicateOp op;
+        if(p[0] == '!' && p[1] == '=') { op = OP_NE; p += 2; }
+        else if(p[0] == '<' && p[1] == '=') { op = OP_LE; p += 2; }
+        else if(p[0] == '>' && p[1] == '=') { op = OP_GE; p += 2; }
+        else if(p[0] == '=') { op = OP_EQ; p++; }
+        else if(p[0] == '<') { op = OP_LT; p++; }
+        else if(p[0] == '>') { op = OP_GT; p++; }
+        else if(p[0] == '~') { op = OP_CONTAINS; p++; }
+        else {
+            printf("Missing operator after '%s'!\n", name);
+            return 0;
+        }
+        
+        char value[100];
+        int v = 0;
+        if(*p == '"') {
+            p++;
+            while(*p && *p != '"' && v < 99) value[v++] = *p++;
+            if(*p == '"') p++;
+        } else {
+            while(*p && *p != ' ' && v < 99) value[v++] = *p++;
+        }
+        value[v] = '\0';
+        
+        if(strcmp(name, "limit") == 0 || strcmp(name, "offset") == 0) {
+            if(op != OP_EQ) {
+                printf("Use %s=N\n", name);
+                return 0;
+            }
+            if(name[0] == 'l') query->limit = atoi(value);
+            else query->offset = atoi(value);
+            continue;
+        }
+        
+        const FieldDef* field = NULL;
+        for(int f = 0; fields[f].name != NULL; f++) {
+            if(strcmp(fields[f].name, name) == 0) {
+                field = &fields[f];
+                break;
+            }
+        }
+        if(field == NULL) {
+            printf("Unknown field '%s'!\n", name);
+            return 0;
+        }
+        if(field->type == FIELD_INT && op == OP_CONTAINS) {
+            printf("'~' only applies to text fields!\n");
+            return 0;
+        }
+        if(query->predicate_count >= MAX_PREDICATES) {
+            printf("Too many conditions (max %d)!\n", MAX_PREDICATES);
+            return 0;
+        }
+        
+        Predicate* pred = &query->predicates[query->predicate_count++];
+        pred->field = field;
+        pred->op = op;
+        strcpy(pred->value, value);
+        pred->int_value = atoi(value);
+    }
+    return 1;
+}
+
+// Helper function to pick the most selective index for a query. Fills
+// candidates with record slots and returns their count, or -1 when no
+// index beats a full scan.
+int planQuery(Query* query, int* candidates) {
+    int best = -1;
+    int best_cost = query->table == QUERY_TABLE_BOOKS ? book_count :
+                    query->table == QUERY_TABLE_MEMBERS ? member_count :
+                    transaction_count;
+    int best_bucket = -1;
+    HistoryList* best_history = NULL;
+    int* best_next = NULL;
+    
+    for(int i = 0; i < query->predicate_count; i++) {
+        Predicate* pred = &query->predicates[i];
+        int cost = -1;
+        int bucket = -1;
+        HistoryList* history = NULL;
+        int* next = NULL;
+        
+        if(query->table == QUERY_TABLE_TRANSACTIONS) {
+            // Only member_id/book_id equality is indexed for transactions
+            if(pred->op == OP_EQ && strcmp(pred->field->name, "member_id") == 0) {
+                history = findHistory(member_history, pred->int_value, 0);
+                next = member_history_next;
+                cost = history != NULL ? history->count : 0;
+            } else if(pred->op == OP_EQ && strcmp(pred->field->name, "book_id") == 0) {
+                history = findHistory(book_history, pred->int_value, 0);
+                next = book_history_next;
+                cost = history != NULL ? history->count : 0;
+            }
+        } else if(pred->op == OP_EQ && (strcmp(pred->field->name, "id") == 0 ||
+                                 strcmp(pred->field->name, "isbn") == 0 ||
+                                 strcmp(pred->field->name, "membership_id") == 0)) {
+            cost = 1;
+        } else if(query->table == QUERY_TABLE_BOOKS && pred->op == OP_CONTAINS &&
+                  (strcmp(pred->field->name, "title") == 0 ||
+                   strcmp(pred->field->name, "author") == 0) &&
+                  strlen(pred->value) >= FUZZY_GRAM) {
+            // Every n-gram of a contained value appears in the record, so
+            // the smallest posting list bounds the candidates
+            if(fuzzy_index_dirty) {
+                rebuildFuzzyIndex();
+            }
+            int len = strlen(pred->value);
+            for(int j = 0; j + FUZZY_GRAM <= len; j++) {
+                uint32_t h = 0;
+                for(int k = 0; k < FUZZY_GRAM; k++) {
+                    h = h * 31 + (unsigned char)tolower((unsigned char)pred->value[j + k]);
+                }
+                h %= FUZZY_BUCKETS;
+                int size = fuzzy_bucket_start[h + 1] - fuzzy_bucket_start[h];
+                if(cost == -1 || size < cost) {
+                    cost = size;
+                    bucket = h;
+                }
+            }
+        }
+        
+        if(cost != -1 && cost < best_cost) {
+            best = i;
+            best_cost = cost;
+            best_bucket = bucket;
+            best_history = history;
+            best_next = next;
+        }
+    }
+    
+    if(best == -1) {
+        return -1;
+    }
+    
+    Predicate* pred = &query->predicates[best];
+    if(query->table == QUERY_TABLE_TRANSACTIONS) {
+        int count = 0;
+        if(best_history != NULL) {
+            for(int t = best_history->head; t != -1; t = best_next[t]) {
+                candidates[count++] = t;
+            }
+        }
+        return count;
+    }
+    if(best_bucket != -1) {
+        int count = 0;
+        for(int p = fuzzy_bucket_start[best_bucket]; p < fuzzy_bucket_start[best_bucket + 1]; p++) {
+            candidates[count++] = fuzzy_postings[p];
+        }
+        return count;
+    }
+    
+    int index = -1;
+    if(strcmp(pred->field->name, "isbn") == 0) {
+        index = findBookByISBN(pred->value);
+    } else if(strcmp(pred->field->name, "membership_id") == 0) {
+        index = findMemberByMembershipId(pred->value);
+    } else if(query->table == QUERY_TABLE_BOOKS) {
+        index = findBookById(pred->int_value);
+    } else {
+        index = findMemberById(pred->int_value);
+    }
+    if(index == -1) {
+        return 0;
+    }
+    candidates[0] = index;
+    return 1;
+}
+
+// Helper function to test a record against every predicate of a query
+int matchRecord(const void* record, Query* query) {
+    for(int i = 0; i < query->predicate_count; i++) {
+        Predicate* pred = &query->predicates[i];
+        const char* field = (const char*)record + pred->field->offset;
+        int cmp;
+        
+        if(pred->op == OP_CONTAINS) {
+            if(strstr(field, pred->value) == NULL) return 0;
+            continue;
+        }
+        
+        if(pred->field->type == FIELD_INT) {
+            int value = *(const int*)field;
+            cmp = (value > pred->int_value) - (value < pred->int_value);
+        } else {
+            // Dates are stored as YYYY-MM-DD, so string order is date order
+            cmp = strcmp(field, pred->value);
+        }
+        
+        switch(pred->op) {
+            case OP_EQ: if(cmp != 0) return 0; break;
+            case OP_NE: if(cmp == 0) return 0; break;
+            case OP_LT: if(cmp >= 0) return 0; break;
+            case OP_LE: if(cmp > 0) return 0; break;
+            case OP_GT: if(cmp <= 0) return 0; break;
+            case OP_GE: if(cmp < 0) return 0; break;
+            default: break;
+        }
+    }
+    return 1;
+}
+
+// Helper functions to print table rows in the same layout as the views
+void printBookHeader(FILE* out) {
+    fprintf(out, "%-5s %-30s %-20s %-13s %-8s %-10s %-10s %-15s\n", 
+           "ID", "Title", "Author", "ISBN", "Year", "Quantity", "Available", "Category");
+    fprintf(out, "--------------------------------------------------------------------------------------------------------\n");
+}
+
+void printBookRow(FILE* out, Book* book) {
+    fprintf(out, "%-5d %-30s %-20s %-13s %-8d %-10d %-10d %-15s\n",
+           book->id,
+           book->title,
+           book->author,
+           book->ISBN,
+           book->year,
+           book->quantity,
+           book->available,
+           book->category);
+}
+
+void printMemberHeader(FILE* out) {
+    fprintf(out, "%-5s %-20s %-15s %-25s %-15s %-10s %-15s\n", 
+           "ID", "Name", "Membership ID", "Email", "Phone", "Issued", "Join Date");
+    fprintf(out, "--------------------------------------------------------------------------------------------------\n");
+}
+
+void printMemberRow(FILE* out, Member* member) {
+    fprintf(out, "%-5d %-20s %-15s %-25s %-15s %-10d %-15s\n",
+           member->id,
+           member->name,
+           member->membership_id,
+           member->email,
+           member->phone,
+           member->books_issued,
+           member->join_date);
+}
+
+void printTransactionHeader(FILE* out) {
+    fprintf(out, "%-10s %-8s %-8s %-12s %-12s %-12s %-8s\n", 
+           "Trans ID", "Book ID", "Member ID", "Issue Date", "Due Date", "Return Date", "Status");
+    fprintf(out, "----------------------------------------------------------------------------------\n");
+}
+
+void printTransactionRow(FILE* out, Transaction* transaction) {
+    fprintf(out, "%-10d %-8d %-8d %-12s %-12s %-12s %-8s\n",
+           transaction->transaction_id,
+           transaction->book_id,
+           transaction->member_id,
+           transaction->issue_date,
+           transaction->due_date,
+           transaction->return_date[0] ? transaction->return_date : "N/A",
+           transaction->returned ? "Returned" : "Issued");
+}
+
+// Helper function to look up a history list by member/book id, optionally
+// claiming an empty slot for it
+HistoryList* findHistory(HistoryList* index, int key, int create) {
+    uint32_t slot = ((uint32_t)key * 2654435761U) & (HISTORY_SLOTS - 1);
+    while(index[slot].key != 0) {
+        if(index[slot].key == key) {
+            return &index[slot];
+        }
+        slot = (slot + 1) & (HISTORY_SLOTS - 1);
+    }
+    if(!create || key == 0) {
+        return NULL;
+    }
+    index[slot].key = key;
+    index[slot].head = -1;
+    index[slot].tail = -1;
+    index[slot].count = 0;
+    return &index[slot];
+}
+
+// Helper function to append a transaction slot to its member's and book's
+// history lists
+void indexTransaction(int slot) {
+    HistoryList* member = findHistory(member_history, transactions[slot].member_id, 1);
+    HistoryList* book = findHistory(book_history, transactions[slot].book_id, 1);
+    
+    member_history_next[slot] = -1;
+    book_history_next[slot] = -1;
+    if(member != NULL) {
+        if(member->tail == -1) member->head = slot;
+        else member_history_next[member->tail] = slot;
+        member->tail = slot;
+        member->count++;
+    }
+    if(book != NULL) {
+        if(book->tail == -1) book->head = slot;
+        else book_history_next[book->tail] = slot;
+        book->tail = slot;
+        book->count++;
+    }
+}
+
+// Helper function to rebuild both history indexes from transactions[]
+void rebuildLoanHistory() {
+    memset(member_history, 0, sizeof(member_history));
+    memset(book_history, 0, sizeof(book_history));
+    for(int i = 0; i < transaction_count; i++) {
+        indexTransaction(i);
+    }
+}
+
+// Helper function to switch this process to one branch's shard, creating
+// its directory on first use. Every data file is opened relative to the
+// working directory, so each branch gets its own files and indexes.
+int selectBranch(const char* name) {
+    int length = strlen(name);
+    if(length == 0 || length >= MAX_BRANCH_NAME) {
+        fprintf(stderr, "Invalid branch name!\n");
+        return 0;
+    }
+    for(int i = 0; i < length; i++) {
+        if(!isalnum((unsigned char)name[i]) && name[i] != '-' && name[i] != '_') {
+            fprintf(stderr, "Branch names may only use letters, digits, '-' and '_'.\n");
+            return 0;
+        }
+    }
+    
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/%s", BRANCHES_DIR, name);
+    mkdir(BRANCHES_DIR, 0755);
+    mkdir(path, 0755);
+    if(chdir(path) != 0) {
+        fprintf(stderr, "Cannot open branch directory %s!\n", path);
+        return 0;
+    }
+    strcpy(branch_name, name);
+    strcpy(branch_root, "..");
+    return 1;
+}
+
+// Helper function to order branch scans by name
+int compareBranchName(const void* a, const void* b) {
+    return strcmp(((const BranchScan*)a)->name, ((const BranchScan*)b)->name);
+}
+
+// Helper function to scan every branch on its own thread. Other branches
+// are read from their files and never written, so this needs no locking
+// against the processes serving them; their files are checked against the
+// checksum sidecars, and a branch that is mid-save or damaged is reported
+// as skipped. Returns the number of branches.
+int scanBranches(Query* query, BranchScan* scans) {
+    int count = 0;
+    DIR* dir = opendir(branch_root);
+    if(dir != NULL) {
+        struct dirent* entry;
+        while((entry = readdir(dir)) != NULL && count < MAX_BRANCHES) {
+            if(entry->d_name[0] == '.' || strlen(entry->d_name) >= MAX_BRANCH_NAME) {
+                continue;
+            }
+            BranchScan* scan = &scans[count];
+            memset(scan, 0, sizeof(*scan));
+            strcpy(scan->name, entry->d_name);
+            snprintf(scan->path, sizeof(scan->path), "%s/%s", branch_root, entry->d_name);
+            struct stat info;
+            if(stat(scan->path, &info) != 0 || !S_ISDIR(info.st_mode)) {
+                continue;
+            }
+            scan->local = strcmp(scan->name, branch_name) == 0;
+            scan->query = query;
+            count++;
+        }
+        closedir(dir);
+    }
+    qsort(scans, count, sizeof(BranchScan), compareBranchName);
+    
+    // Not running as a branch: the current directory counts as one
+    if(!branch_name[0] && count < MAX_BRANCHES) {
+        memset(&scans[count], 0, sizeof(BranchScan));
+        strcpy(scans[count].name, "(local)");
+        scans[count].local = 1;
+        scans[count].query = query;
+        count++;
+    }
+    
+    pthread_t threads[MAX_BRANCHES];
+    int started[MAX_BRANCHES];
+    for(int b = 0; b < count; b++) {
+        started[b] = pthread_create(&threads[b], NULL, scanBranch, &scans[b]) == 0;
+        if(!started[b]) {
+            scanBranch(&scans[b]);
+        }
+    }
+    for(int b = 0; b < count; b++) {
+        if(started[b]) {
+            pthread_join(threads[b], NULL);
+        }
+    }
+    return count;
+}
+
+// Fan-out thread: totals and query matches for one branch. The local
+// branch is scanned in memory so unsaved changes are included; the main
+// thread is blocked in scanBranches meanwhile.
+void* scanBranch(void* arg) {
+    BranchScan* scan = arg;
+    Book* branch_books = books;
+    Transaction* branch_transactions = NULL;
+    int branch_book_count = book_count;
+    int branch_transaction_count = 0;
+    scan->members = member_count;
+    scan->open_loans = scan->local ? open_loan_count : 0;
+    
+    if(!scan->local) {
+        // A journal on disk means that branch is part way through a save;
+        // checked on both sides of the reads so none of them overlaps one
+        char journal[MAX_PATH + 20];
+        snprintf(journal, sizeof(journal), "%s/%s", scan->path, FILENAME_JOURNAL);
+        branch_books = malloc(sizeof(Book) * MAX_BOOKS);
+        branch_transactions = malloc(sizeof(Transaction) * MAX_BOOKS * 10);
+        Member* branch_members = malloc(sizeof(Member) * MAX_MEMBERS);
+        if(branch_books == NULL || branch_transactions == NULL || branch_members == NULL) {
+            strcpy(scan->error, "out of memory");
+        } else if(access(journal, F_OK) == 0 ||
+                  !readBranchTable(scan, FILENAME_BOOKS, FILENAME_BOOKS_CRC, sizeof(Book), MAX_BOOKS,
+                                   branch_books, &branch_book_count) ||
+                  !readBranchTable(scan, FILENAME_TRANSACTIONS, FILENAME_TRANSACTIONS_CRC, sizeof(Transaction),
+                                   MAX_BOOKS * 10, branch_transactions, &branch_transaction_count) ||
+                  !readBranchTable(scan, FILENAME_MEMBERS, FILENAME_MEMBERS_CRC, sizeof(Member), MAX_MEMBERS,
+                                   branch_members, &scan->members) ||
+                  access(journal, F_OK) == 0) {
+            if(!scan->error[0]) {
+                strcpy(scan->error, "save in progress, try again");
+            }
+        }
+        free(branch_members);
+    }
+    
+    if(!scan->error[0]) {
+        scan->books = branch_book_count;
+        if(scan->query != NULL) {
+            scan->matches = malloc(sizeof(Book) * (branch_book_count > 0 ? branch_book_count : 1));
+        }
+        for(int i = 0; i < branch_book_count; i++) {
+            scan->copies += branch_books[i].quantity;
+            scan->available += branch_books[i].available;
+            if(scan->matches != NULL && matchRecord(&branch_books[i], scan->query)) {
+                scan->matches[scan->match_count++] = branch_books[i];
+            }
+        }
+        for(int i = 0; i < branch_transaction_count; i++) {
+            scan->open_loans += !branch_transactions[i].returned;
+        }
+    }
+    
+    if(!scan->local) {
+        free(branch_books);
+        free(branch_transactions);
+    }
+    return NULL;
+}
+
+// Helper function to read and verify one table of another branch. Sets
+// count (0 if the file does not exist yet); on damage, fills scan->error
+// and returns 0.
+int readBranchTable(BranchScan* scan, const char* filename, const char* checksum_filename,
+                    size_t record_size, int capacity, void* records, int* count) {
+    char path[MAX_PATH + 20], checksum_path[MAX_PATH + 20], error[200];
+    snprintf(path, sizeof(path), "%s/%s", scan->path, filename);
+    snprintf(checksum_path, sizeof(checksum_path), "%s/%s", scan->path, checksum_filename);
+    int unverified;
+    if(readVerifiedTable(path, checksum_path, record_size, capacity, records, count,
+                         &unverified, error, sizeof(error)) == 0) {
+        copyText(scan->error, error, sizeof(scan->error));
+        return 0;
+    }
+    return 1;
+}
+
+// Helper function to look up the hold queue of a book id, optionally
+// claiming an empty slot for it
+HoldQueue* findHoldQueue(int book_id, int create) {
+    uint32_t slot = ((uint32_t)book_id * 2654435761U) & (HISTORY_SLOTS - 1);
+    while(hold_queues[slot].key != 0) {
+        if(hold_queues[slot].key == book_id) {
+            return &hold_queues[slot];
+        }
+        slot = (slot + 1) & (HISTORY_SLOTS - 1);
+    }
+    if(!create || book_id == 0) {
+        return NULL;
+    }
+    hold_queues[slot].key = book_id;
+    hold_queues[slot].head = -1;
+    hold_queues[slot].tail = -1;
+    hold_queues[slot].ready_head = -1;
+    return &hold_queues[slot];
+}
+
+// Helper function to look up the active-hold count of a member on a book,
+// optionally claiming an empty slot for the pair
+HoldPair* findHoldPair(int book_id, int member_id, int create) {
+    uint32_t slot = ((uint32_t)book_id * 2654435761U ^ (uint32_t)member_id * 2246822519U) & (HOLD_PAIR_SLOTS - 1);
+    while(hold_pairs[slot].book_id != 0) {
+        if(hold_pairs[slot].book_id == book_id && hold_pairs[slot].member_id == member_id) {
+            return &hold_pairs[slot];
+        }
+        slot = (slot + 1) & (HOLD_PAIR_SLOTS - 1);
+    }
+    if(!create || book_id == 0) {
+        return NULL;
+    }
+    hold_pairs[slot].book_id = book_id;
+    hold_pairs[slot].member_id = member_id;
+    hold_pairs[slot].active = 0;
+    return &hold_pairs[slot];
+}
+
+// Helper function to link an active hold into its book's waiting FIFO
+// (at the tail) or ready list, according to its status, and count it for
+// its member
+void linkHold(int slot) {
+    HoldQueue* queue = findHoldQueue(holds[slot].book_id, 1);
+    findHoldPair(holds[slot].book_id, holds[slot].member_id, 1)->active++;
+    hold_expire_day[slot] = parseDay(holds[slot].expires_date);
+    hold_next[slot] = -1;
+    hold_prev[slot] = -1;
+    
+    if(holds[slot].status == HOLD_READY) {
+        hold_next[slot] = queue->ready_head;
+        if(queue->ready_head != -1) hold_prev[queue->ready_head] = slot;
+        queue->ready_head = slot;
+        queue->ready++;
+    } else {
+        hold_prev[slot] = queue->tail;
+        if(queue->tail != -1) hold_next[queue->tail] = slot;
+        else queue->head = slot;
+        queue->tail = slot;
+        queue->waiting++;
+    }
+}
+
+// Helper function to unlink an active hold from its book's list and its
+// member's count in O(1)
+void unlinkHold(int slot) {
+    HoldQueue* queue = findHoldQueue(holds[slot].book_id, 0);
+    findHoldPair(holds[slot].book_id, holds[slot].member_id, 0)->active--;
+    int next = hold_next[slot];
+    int prev = hold_prev[slot];
+    if(next != -1) hold_prev[next] = prev;
+    
+    if(holds[slot].status == HOLD_READY) {
+        if(prev != -1) hold_next[prev] = next;
+        else queue->ready_head = next;
+        queue->ready--;
+    } else {
+        if(prev != -1) hold_next[prev] = next;
+        else queue->head = next;
+        if(next == -1) queue->tail = prev;
+        queue->waiting--;
+    }
+    hold_next[slot] = -1;
+    hold_prev[slot] = -1;
+}
+
+// Helper function to set shelf copies of a book aside for the holders at
+// the front of its queue; constant time per copy handed off. Returns the
+// slot of the last hold readied, or -1 if none was.
+int handOffCopies(int book_index) {
+    int readied = -1;
+    HoldQueue* queue = findHoldQueue(books[book_index].id, 0);
+    if(queue == NULL) {
+        return readied;
+    }
+    while(books[book_index].available > 0 && queue->head != -1) {
+        int slot = queue->head;
+        unlinkHold(slot);
+        
+        // Holders who have since left the library are skipped
+        if(findMemberById(holds[slot].member_id) == -1) {
+            holds[slot].status = HOLD_CANCELLED;
+            markDirty(TABLE_HOLDS, slot);
+            continue;
+        }
+        
+        holds[slot].status = HOLD_READY;
+        char today[11];
+        getCurrentDate(today);
+        addDays(today, holds[slot].expires_date, HOLD_PICKUP_DAYS);
+        linkHold(slot);
+        pushHoldDeadline(slot);
+        markDirty(TABLE_HOLDS, slot);
+        
+        books[book_index].available--;
+        markDirty(TABLE_BOOKS, book_index);
+        readied = slot;
+    }
+    return readied;
+}
+
+// Helper function to expire holds whose deadline has passed, cheapest
+// first off the expiry heap; a lapsed ready hold passes its copy on
+void sweepExpiredHolds() {
+    int today = currentDay();
+    while(hold_heap_size > 0 && hold_heap[0].day < today) {
+        HoldDeadline top = hold_heap[0];
+        
+        // Pop the root and sift the last entry down
+        HoldDeadline last = hold_heap[--hold_heap_size];
+        int i = 0;
+        for(;;) {
+            int child = 2 * i + 1;
+            if(child >= hold_heap_size) break;
+            if(child + 1 < hold_heap_size && hold_heap[child + 1].day < hold_heap[child].day) child++;
+            if(hold_heap[child].day >= last.day) break;
+            hold_heap[i] = hold_heap[child];
+            i = child;
+        }
+        if(hold_heap_size > 0) hold_heap[i] = last;
+        
+        int slot = top.slot;
+        int status = holds[slot].status;
+        if((status != HOLD_WAITING && status != HOLD_READY) || hold_expire_day[slot] != top.day) {
+            continue;   // stale entry
+        }
+        unlinkHold(slot);
+        holds[slot].status = HOLD_EXPIRED;
+        markDirty(TABLE_HOLDS, slot);
+        
+        if(status == HOLD_READY) {
+            int book_index = findBookById(holds[slot].book_id);
+            if(book_index != -1) {
+                books[book_index].available++;
+                markDirty(TABLE_BOOKS, book_index);
+                handOffCopies(book_index);
+            }
+        }
+    }
+}
+
+// Helper function to find a member's ready hold on a book, or -1
+int findReadyHold(int book_id, int member_id) {
+    HoldQueue* queue = findHoldQueue(book_id, 0);
+    if(queue == NULL) {
+        return -1;
+    }
+    for(int slot = queue->ready_head; slot != -1; slot = hold_next[slot]) {
+        if(holds[slot].member_id == member_id) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+// Helper function to add a hold's current expiry to the expiry heap
+void pushHoldDeadline(int slot) {
+    if(hold_heap_size >= MAX_HOLDS * 2) {
+        return;
+    }
+    HoldDeadline entry = {hold_expire_day[slot], slot};
+    int i = hold_heap_size++;
+    while(i > 0 && hold_heap[(i - 1) / 2].day > entry.day) {
+        hold_heap[i] = hold_heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    hold_heap[i] = entry;
+}
+
+// Helper function to rebuild the hold queues and expiry heap from holds[];
+// slot order is placement order, so FIFO order is preserved
+void rebuildHoldQueues() {
+    memset(hold_queues, 0, sizeof(hold_queues));
+    memset(hold_pairs, 0, sizeof(hold_pairs));
+    hold_heap_size = 0;
+    for(int i = 0; i < hold_count; i++) {
+        if(holds[i].status == HOLD_WAITING || holds[i].status == HOLD_READY) {
+            linkHold(i);
+            pushHoldDeadline(i);
+        }
+    }
+}
+
+// Helper function to get today as days since 1970-01-01
+int currentDay() {
+    char current_date[11];
+    getCurrentDate(current_date);
+    return parseDay(current_date);
+}
+
+// Helper function to count a new loan in the popularity counters; call
+// after indexIssueDate so the loan's issue day is known
+void recordLoan(int slot) {
+    int index = findBookById(transactions[slot].book_id);
+    if(index == -1) {
+        return;
+    }
+    Book* book = &books[index];
+    countAuthorLoan(book);
+    sketchAdd(title_window, issue_day[slot], book->id, book->title, 0);
+    sketchAdd(author_window, issue_day[slot], authorKey(book->author), book->author, 1);
+}
+
+// Helper function to bump the exact lifetime loan count of a book's author
+void countAuthorLoan(Book* book) {
+    uint32_t key = authorKey(book->author);
+    uint32_t h = (key * 2654435761U) & (HISTORY_SLOTS - 1);
+    while(author_loans[h].key != 0 &&
+          (author_loans[h].key != key || compareAuthors(author_loans[h].author, book->author) != 0)) {
+        h = (h + 1) & (HISTORY_SLOTS - 1);
+    }
+    if(author_loans[h].key == 0) {
+        author_loans[h].key = key;
+        strcpy(author_loans[h].author, book->author);
+    }
+    author_loans[h].count++;
+}
+
+// Helper function to count one occurrence in a day's Space-Saving sketch,
+// recycling the ring slot if it still holds an older day. With match_label
+// the key is a hash, so a counter must also carry the same author.
+void sketchAdd(DaySketch* window, int day, uint32_t key, const char* label, int match_label) {
+    DaySketch* sketch = &window[((day % POPULARITY_WINDOW_DAYS) + POPULARITY_WINDOW_DAYS) % POPULARITY_WINDOW_DAYS];
+    if(sketch->day != day) {
+        sketch->day = day;
+        sketch->size = 0;
+    }
+    
+    int min = 0;
+    for(int i = 0; i < sketch->size; i++) {
+        if(sketch->counters[i].key == key &&
+           (!match_label || compareAuthors(sketch->counters[i].label, label) == 0)) {
+            sketch->counters[i].count++;
+            return;
+        }
+        if(sketch->counters[i].count < sketch->counters[min].count) {
+            min = i;
+        }
+    }
+    
+    HeavyHitter* counter;
+    if(sketch->size < SKETCH_COUNTERS) {
+        counter = &sketch->counters[sketch->size++];
+        counter->count = 0;
+        counter->error = 0;
+    } else {
+        // Evict the smallest counter; the newcomer inherits its count
+        counter = &sketch->counters[min];
+        counter->error = counter->count;
+    }
+    counter->key = key;
+    counter->count++;
+    strncpy(counter->label, label, MAX_TITLE - 1);
+    counter->label[MAX_TITLE - 1] = '\0';
+}
+
+// Helper function to rebuild the popularity counters after loading; the
+// sketches only need the loans inside the window
+void rebuildPopularity() {
+    memset(author_loans, 0, sizeof(author_loans));
+    memset(title_window, 0, sizeof(title_window));
+    memset(author_window, 0, sizeof(author_window));
+    for(int w = 0; w < POPULARITY_WINDOW_DAYS; w++) {
+        title_window[w].day = -1;
+        author_window[w].day = -1;
+    }
+    
+    char current_date[11];
+    getCurrentDate(current_date);
+    int window_start = parseDay(current_date) - POPULARITY_WINDOW_DAYS + 1;
+    
+    // Resolve every loan's book slot in one merge pass; without memory for
+    // that, fall back to a lookup per loan
+    int* book_ids = malloc(sizeof(int) * (transaction_count + 1));
+    int* book_indexes = malloc(sizeof(int) * (transaction_count + 1));
+    if(book_ids != NULL && book_indexes != NULL) {
+        for(int i = 0; i < transaction_count; i++) {
+            book_ids[i] = transactions[i].book_id;
+        }
+        resolveIds(book_ids, transaction_count, books, sizeof(Book), book_count, book_indexes);
+    } else {
+        free(book_indexes);
+        book_indexes = NULL;
+    }
+    
+    for(int i = 0; i < transaction_count; i++) {
+        int index = book_indexes != NULL ? book_indexes[i] : findBookById(transactions[i].book_id);
+        if(index != -1) {
+            countAuthorLoan(&books[index]);
+        }
+    }
+    
+    for(int i = findFirstIssuedOnOrAfter(window_start); i < transaction_count; i++) {
+        int slot = issue_order[i];
+        int index = book_indexes != NULL ? book_indexes[slot] : findBookById(transactions[slot].book_id);
+        if(index == -1) continue;
+        sketchAdd(title_window, issue_day[slot], books[index].id, books[index].title, 0);
+        sketchAdd(author_window, issue_day[slot], authorKey(books[index].author), books[index].author, 1);
+    }
+    free(book_ids);
+    free(book_indexes);
+}
+
+// Helper function to hash a case-folded author name (FNV-1a); never 0
+uint32_t authorKey(const char* author) {
+    uint32_t h = 2166136261U;
+    for(int i = 0; author[i]; i++) {
+        h ^= (unsigned char)tolower((unsigned char)author[i]);
+        h *= 16777619U;
+    }
+    return h != 0 ? h : 1;
+}
+
+// Helper function to compare author names ignoring case, the equality
+// authorKey hashes; keys can collide, so counters compare names too
+int compareAuthors(const char* a, const char* b) {
+    int i = 0;
+    while(a[i] && tolower((unsigned char)a[i]) == tolower((unsigned char)b[i])) {
+        i++;
+    }
+    return tolower((unsigned char)a[i]) - tolower((unsigned char)b[i]);
+}
+
+// Helper function to find a member's fines, optionally claiming an empty
+// slot for them
+MemberFines* findMemberFines(int member_id, int create) {
+    uint32_t slot = ((uint32_t)member_id * 2654435761U) & (HISTORY_SLOTS - 1);
+    while(member_fines[slot].member_id != 0) {
+        if(member_fines[slot].member_id == member_id) {
+            return &member_fines[slot];
+        }
+        slot = (slot + 1) & (HISTORY_SLOTS - 1);
+    }
+    if(!create || member_id == 0) {
+        return NULL;
+    }
+    member_fines[slot].member_id = member_id;
+    return &member_fines[slot];
+}
+
+// Helper function to get the late fee the loan in slot has run up by day;
+// an unreadable due date accrues nothing
+int accruedFine(int slot, int day) {
+    int due = parseDay(transactions[slot].due_date);
+    if(due == INVALID_DAY || due >= day) {
+        return 0;
+    }
+    return (day - due) * FINE_CENTS_PER_DAY;
+}
+
+// Helper function to recompute every member's accrued fines from the open
+// loans as of day
+void accrueOpenLoans(int day) {
+    for(int h = 0; h < HISTORY_SLOTS; h++) {
+        member_fines[h].accrued_cents = 0;
+    }
+    for(int k = 0; k < open_loan_count; k++) {
+        int cents = accruedFine(open_loans[k], day);
+        if(cents > 0) {
+            findMemberFines(transactions[open_loans[k]].member_id, 1)->accrued_cents += cents;
+        }
+    }
+}
+
+// Helper function to charge the late fee of the loan in slot, just
+// returned, to its member. What the last accrual counted for the loan while
+// it was open moves out of the accrued balance, so it is not owed twice.
+void chargeReturnFine(int slot, int fine_cents) {
+    int accrued = fines_as_of != -1 ? accruedFine(slot, fines_as_of) : 0;
+    if(fine_cents == 0 && accrued == 0) {
+        return;
+    }
+    MemberFines* fines = findMemberFines(transactions[slot].member_id, 1);
+    if(fines == NULL) {
+        return;
+    }
+    fines->settled_cents += fine_cents;
+    fines->accrued_cents = fines->accrued_cents > accrued ? fines->accrued_cents - accrued : 0;
+    fines_unsaved = 1;
+}
+
+// Helper function to read fines.dat: the fees charged at return are read
+// back and the accrued balances are recomputed from the open loans
+void loadFines() {
+    memset(member_fines, 0, sizeof(member_fines));
+    fines_as_of = -1;
+    FILE *file = fopen(FILENAME_FINES, "rb");
+    if(file == NULL) {
+        return;
+    }
+    FinesHeader header;
+    if(fread(&header, sizeof(header), 1, file) == 1 && header.magic == FINES_MAGIC) {
+        FineBalance balance;
+        for(int i = 0; i < header.count && fread(&balance, sizeof(balance), 1, file) == 1; i++) {
+            MemberFines* fines = findMemberFines(balance.member_id, 1);
+            if(fines != NULL) {
+                fines->settled_cents = balance.cents;
+            }
+        }
+        fines_as_of = header.as_of;
+    }
+    fclose(file);
+    if(fines_as_of != -1) {
+        accrueOpenLoans(fines_as_of);
+    }
+}
+
+// Helper function to write fines.dat: the header, then the non-zero fees
+// charged at return (accrued balances follow from the open loans). Written
+// to a temporary file and renamed over the old one so a crash never leaves
+// a partial file.
+int saveFines() {
+    FILE *file = fopen(FILENAME_FINES ".tmp", "wb");
+    if(file == NULL) {
+        return 0;
+    }
+    FinesHeader header = {FINES_MAGIC, fines_as_of, 0};
+    for(int h = 0; h < HISTORY_SLOTS; h++) {
+        if(member_fines[h].member_id != 0 && member_fines[h].settled_cents > 0) header.count++;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for(int h = 0; h < HISTORY_SLOTS && ok; h++) {
+        if(member_fines[h].member_id == 0 || member_fines[h].settled_cents <= 0) continue;
+        FineBalance balance = {member_fines[h].member_id, member_fines[h].settled_cents};
+        ok = fwrite(&balance, sizeof(balance), 1, file) == 1;
+    }
+    ok = fflush(file) == 0 && fsync(fileno(file)) == 0 && ok;
+    fclose(file);
+    if(!ok || rename(FILENAME_FINES ".tmp", FILENAME_FINES) != 0) {
+        unlink(FILENAME_FINES ".tmp");
+        return 0;
+    }
+    return syncDirectory();
+}
+
+// Helper function to add a new transaction slot to the issue-date order.
+// New loans carry today's date, so this is normally an append.
+void indexIssueDate(int slot) {
+    int day = parseDay(transactions[slot].issue_date);
+    issue_day[slot] = day;
+    
+    int pos = slot;
+    while(pos > 0 && issue_day[issue_order[pos - 1]] > day) {
+        issue_order[pos] = issue_order[pos - 1];
+        pos--;
+    }
+    issue_order[pos] = slot;
+}
+
+// Comparator ordering transaction slots by issue date, then slot
+int compareIssueOrder(const void* a, const void* b) {
+    int sa = *(const int*)a;
+    int sb = *(const int*)b;
+    if(issue_day[sa] != issue_day[sb]) {
+        return issue_day[sa] < issue_day[sb] ? -1 : 1;
+    }
+    return sa - sb;
+}
+
+// Helper function to rebuild the issue-date order from transactions[]
+void rebuildIssueDateIndex() {
+    int sorted = 1;
+    for(int i = 0; i < transaction_count; i++) {
+        issue_day[i] = parseDay(transactions[i].issue_date);
+        issue_order[i] = i;
+        if(i > 0 && issue_day[i] < issue_day[i - 1]) {
+            sorted = 0;
+        }
+    }
+    // Files written by this program are already in date order
+    if(!sorted) {
+        qsort(issue_order, transaction_count, sizeof(int), compareIssueOrder);
+    }
+}
+
+// Helper function to binary-search the issue-date order for the first loan
+// issued on or after day
+int findFirstIssuedOnOrAfter(int day) {
+    int low = 0;
+    int high = transaction_count;
+    while(low < high) {
+        int mid = (low + high) / 2;
+        if(issue_day[issue_order[mid]] < day) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Helper function to convert YYYY-MM-DD to days since 1970-01-01 without
+// going through mktime; returns INVALID_DAY for a malformed date or a day
+// the month does not have (every real day, 1969-12-31 included, is valid)
+int parseDay(const char* date) {
+    static const int month_days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int y, m, d;
+    if(sscanf(date, "%4d-%2d-%2d", &y, &m, &d) != 3 || m < 1 || m > 12 || d < 1) {
+        return INVALID_DAY;
+    }
+    int leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if(d > month_days[m - 1] + (m == 2 && leap)) {
+        return INVALID_DAY;
+    }
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// Helper function to convert days since 1970-01-01 back to YYYY-MM-DD
+void formatDay(int day, char* date) {
+    day += 719468;
+    int era = (day >= 0 ? day : day - 146096) / 146097;
+    int doe = day - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    int d = doy - (153 * mp + 2) / 5 + 1;
+    int m = mp < 10 ? mp + 3 : mp - 9;
+    int y = yoe + era * 400 + (m <= 2);
+    sprintf(date, "%04d-%02d-%02d", y, m, d);
+}
+
+// Embeddable library API (see library.h). These calls never prompt or
+// print; each mutating call commits what it changed.
+
+LibraryStatus libraryOpen(char* message, int message_size) {
+    char buffer[1024];
+    int loaded = loadData(buffer, sizeof(buffer));
+    if(message != NULL && message_size > 0) {
+        copyText(message, buffer, message_size);
+    }
+    if(!loaded) {
+        return LIB_CORRUPT;
+    }
+    startCheckpointWriter();
+    return LIB_OK;
+}
+
+LibraryStatus libraryClose(void) {
+    stopCheckpointWriter();
+    return checkpoint_failed ? LIB_IO_ERROR : LIB_OK;
+}
+
+const char* libraryStatusText(LibraryStatus status) {
+    static const char* texts[] = {
+        "ok", "not found", "invalid input", "duplicate ISBN", "storage full",
+        "no copy available", "member issue limit reached", "still on loan",
+        "save failed", "data files damaged"
+    };
+    if(status < LIB_OK || status > LIB_CORRUPT) {
+        return "unknown status";
+    }
+    return texts[status];
+}
+
+LibraryStatus libraryAddBook(const BookInput* input, int* book_id) {
+    LibraryStatus status = addBookRecord(input, book_id);
+    return status == LIB_OK ? commitChanges() : status;
+}
+
+LibraryStatus libraryUpdateBook(int book_id, const BookInput* input) {
+    int index = findBookById(book_id);
+    if(index == -1) {
+        return LIB_NOT_FOUND;
+    }
+    LibraryStatus status = updateBookRecord(index, input);
+    return status == LIB_OK ? commitChanges() : status;
+}
+
+LibraryStatus libraryDeleteBook(int book_id) {
+    int index = findBookById(book_id);
+    if(index == -1) {
+        return LIB_NOT_FOUND;
+    }
+    LibraryStatus status = deleteBookRecord(index);
+    return status == LIB_OK ? commitChanges() : status;
+}
+
+LibraryStatus libraryGetBook(int book_id, Book* book) {
+    int index = findBookById(book_id);
+    if(index == -1) {
+        return LIB_NOT_FOUND;
+    }
+    *book = books[index];
+    return LIB_OK;
+}
+
+int librarySearchBooks(LibrarySearchField field, const char* term, Book* results, int max_results) {
+    // A full ISBN the filter has never seen cannot match anything
+    if(field == LIBRARY_SEARCH_ISBN && isISBNValid(term) && !isbnFilterMayContain(term)) {
+        return 0;
+    }
+    int count = 0;
+    for(int i = 0; i < book_count; i++) {
+        if(bookMatchesField(field, &books[i], term)) {
+            if(count < max_results) {
+                results[count] = books[i];
+            }
+            count++;
+        }
+    }
+    return count;
+}
+
+int libraryFuzzySearch(const char* term, int max_distance, Book* results, int* distances, int max_results) {
+    if(max_results <= 0) {
+        return 0;
+    }
+    int* best_index = malloc(sizeof(int) * max_results);
+    int* best_distance = malloc(sizeof(int) * max_results);
+    int found = best_index != NULL && best_distance != NULL ?
+                fuzzyMatchBooks(term, max_distance, max_results, best_index, best_distance) : 0;
+    for(int i = 0; i < found; i++) {
+        results[i] = books[best_index[i]];
+        if(distances != NULL) {
+            distances[i] = best_distance[i];
+        }
+    }
+    free(best_index);
+    free(best_distance);
+    return found;
+}
+
+LibraryStatus libraryAddMember(const MemberInput* input, int* member_id) {
+    LibraryStatus status = addMemberRecord(input, member_id);
+    return status == LIB_OK ? commitChanges() : status;
+}
+
+LibraryStatus libraryUpdateMember(int member_id, const MemberInput* input) {
+    int index = findMemberById(member_id);
+    if(index == -1) {
+        return LIB_NOT_FOUND;
+    }
+    LibraryStatus status = updateMemberRecord(index, input);
+    return status == LIB_OK ? commitChanges() : status;
+}
+
+LibraryStatus libraryDeleteMember(int member_id) {
+    int index = findMemberById(member_id);
+    if(index == -1) {
+        return LIB_NOT_FOUND;
+    }
+    LibraryStatus status = deleteMemberRecord(index);
+    return status == LIB_OK ? commitChanges() : status;
+}
+
+LibraryStatus libraryGetMember(int member_id, Member* member) {
+    int index = findMemberById(member_id);
+    if(index == -1) {
+        return LIB_NOT_FOUND;
+    }
+    *member = members[index];
+    return LIB_OK;
+}
+
+LibraryStatus libraryIssueBook(int book_id, int member_id, int* transaction_id) {
+    int book_index = findBookById(book_id);
+    int member_index = findMemberById(member_id);
+    if(book_index == -1 || member_index == -1) {
+        return LIB_NOT_FOUND;
+    }
+    LibraryStatus status = issueLoan(book_index, member_index, transaction_id);
+    return status == LIB_OK ? commitChanges() : status;
+}
+
+LibraryStatus libraryReturnBook(int transaction_id, int* fine_cents) {
+    int slot = findOpenLoan(transaction_id);
+    if(slot == -1) {
+        return LIB_NOT_FOUND;
+    }
+    returnLoan(slot, findBookById(transactions[slot].book_id),
+               findMemberById(transactions[slot].member_id), fine_cents, NULL);
+    return commitChanges();
 }
 
-// Function to return a book
-void returnBook() {
-    system("clear || cls");
-    printHeader("RETURN BOOK");
-    
-    int transaction_id;
-    printf("Enter Transaction ID: ");
-    scanf("%d", &transaction_id);
-    clearInputBuffer();
+// Batch issue: the book and member ids of the whole batch are resolved in
+// one merge pass per table, then the loans are made in order and
+// committed together
+int libraryIssueBooks(const LoanRequest* requests, LoanResult* results, int count) {
+    if(count <= 0) {
+        return 0;
+    }
+    int* scratch = malloc(sizeof(int) * count * 4);
+    if(scratch == NULL) {
+        for(int i = 0; i < count; i++) {
+            results[i].status = LIB_IO_ERROR;
+        }
+        return 0;
+    }
+    int* book_ids = scratch;
+    int* member_ids = scratch + count;
+    int* book_indexes = scratch + 2 * count;
+    int* member_indexes = scratch + 3 * count;
+    for(int i = 0; i < count; i++) {
+        book_ids[i] = requests[i].book_id;
+        member_ids[i] = requests[i].member_id;
+    }
+    resolveIds(book_ids, count, books, sizeof(Book), book_count, book_indexes);
+    resolveIds(member_ids, count, members, sizeof(Member), member_count, member_indexes);
     
-    int found = 0;
-    for(int i = 0; i < transaction_count; i++) {
-        if(transactions[i].transaction_id == transaction_id && transactions[i].returned == 0) {
-            found = 1;
-            
-            // Update transaction
-            getCurrentDate(transactions[i].return_date);
-            transactions[i].returned = 1;
-            
-            // Find book and member
-            int book_index = findBookById(transactions[i].book_id);
-            int member_index = findMemberById(transactions[i].member_id);
-            
-            // Update book and member
-            if(book_index != -1) {
-                books[book_index].available++;
-            }
-            if(member_index != -1) {
-                members[member_index].books_issued--;
-            }
-            
-            // Calculate fine if overdue
-            char current_date[11];
-            getCurrentDate(current_date);
-            int days_overdue = dateDifference(transactions[i].due_date, current_date);
-            
-            printf("\nBook returned successfully!\n");
-            printf("Transaction ID: %d\n", transactions[i].transaction_id);
-            printf("Return Date: %s\n", transactions[i].return_date);
-            
-            if(days_overdue > 0) {
-                float fine = days_overdue * 5.0; // $5 per day late fee
-                printf("Overdue by %d days\n", days_overdue);
-                printf("Fine: $%.2f\n", fine);
-            } else {
-                printf("Returned on time. No fine.\n");
-            }
-            break;
+    int issued = 0;
+    for(int i = 0; i < count; i++) {
+        results[i].transaction_id = 0;
+        results[i].fine_cents = 0;
+        if(book_indexes[i] == -1 || member_indexes[i] == -1) {
+            results[i].status = LIB_NOT_FOUND;
+            continue;
         }
+        results[i].status = issueLoan(book_indexes[i], member_indexes[i], &results[i].transaction_id);
+        issued += results[i].status == LIB_OK;
     }
+    free(scratch);
     
-    if(!found) {
-        printf("Transaction not found or book already returned!\n");
+    LibraryStatus committed = issued > 0 ? commitChanges() : LIB_OK;
+    for(int i = 0; i < count && committed != LIB_OK; i++) {
+        if(results[i].status == LIB_OK) results[i].status = committed;
     }
+    return committed == LIB_OK ? issued : 0;
 }
 
-// Function to view transactions
-void viewTransactions() {
-    system("clear || cls");
-    printHeader("VIEW TRANSACTIONS");
-    
-    if(transaction_count == 0) {
-        printf("No transactions found!\n");
-        return;
+// Batch return: loans are found in the open-loan set, their books and
+// members resolved in one merge pass per table, and all returns committed
+// together
+int libraryReturnBooks(const int* transaction_ids, LoanResult* results, int count) {
+    if(count <= 0) {
+        return 0;
+    }
+    int* scratch = malloc(sizeof(int) * count * 5);
+    if(scratch == NULL) {
+        for(int i = 0; i < count; i++) {
+            results[i].status = LIB_IO_ERROR;
+        }
+        return 0;
     }
+    int* slots = scratch;
+    int* book_ids = scratch + count;
+    int* member_ids = scratch + 2 * count;
+    int* book_indexes = scratch + 3 * count;
+    int* member_indexes = scratch + 4 * count;
+    for(int i = 0; i < count; i++) {
+        slots[i] = findOpenLoan(transaction_ids[i]);
+        book_ids[i] = slots[i] != -1 ? transactions[slots[i]].book_id : 0;
+        member_ids[i] = slots[i] != -1 ? transactions[slots[i]].member_id : 0;
+    }
+    resolveIds(book_ids, count, books, sizeof(Book), book_count, book_indexes);
+    resolveIds(member_ids, count, members, sizeof(Member), member_count, member_indexes);
     
-    printf("%-10s %-8s %-8s %-12s %-12s %-12s %-8s\n", 
-           "Trans ID", "Book ID", "Member ID", "Issue Date", "Due Date", "Return Date", "Status");
-    printf("----------------------------------------------------------------------------------\n");
+    int returned = 0;
+    for(int i = 0; i < count; i++) {
+        results[i].transaction_id = transaction_ids[i];
+        results[i].fine_cents = 0;
+        // The same loan listed twice is only returned once
+        if(slots[i] == -1 || transactions[slots[i]].returned) {
+            results[i].status = LIB_NOT_FOUND;
+            continue;
+        }
+        results[i].status = returnLoan(slots[i], book_indexes[i], member_indexes[i], &results[i].fine_cents, NULL);
+        returned++;
+    }
+    free(scratch);
     
-    for(int i = 0; i < transaction_count; i++) {
-        printf("%-10d %-8d %-8d %-12s %-12s %-12s %-8s\n",
-               transactions[i].transaction_id,
-               transactions[i].book_id,
-               transactions[i].member_id,
-               transactions[i].issue_date,
-               transactions[i].due_date,
-               transactions[i].return_date[0] ? transactions[i].return_date : "N/A",
-               transactions[i].returned ? "Returned" : "Issued");
+    LibraryStatus committed = returned > 0 ? commitChanges() : LIB_OK;
+    for(int i = 0; i < count && committed != LIB_OK; i++) {
+        if(results[i].status == LIB_OK) results[i].status = committed;
     }
+    return committed == LIB_OK ? returned : 0;
 }
 
-// Function to generate reports
-void generateReports() {
-    system("clear || cls");
-    printHeader("GENERATE REPORTS");
-    
-    int choice;
-    printf("1. Books Available\n");
-    printf("2. Books Issued\n");
-    printf("3. Overdue Books\n");
-    printf("4. Member Report\n");
-    printf("5. Category-wise Report\n");
-    printf("Enter choice: ");
-    scanf("%d", &choice);
-    clearInputBuffer();
-    
-    switch(choice) {
-        case 1: {
-            system("clear || cls");
-            printHeader("BOOKS AVAILABLE");
-            printf("%-5s %-30s %-20s %-10s\n", "ID", "Title", "Author", "Available");
-            printf("--------------------------------------------------------------\n");
-            for(int i = 0; i < book_count; i++) {
-                if(books[i].available > 0) {
-                    printf("%-5d %-30s %-20s %-10d\n",
-                           books[i].id,
-                           books[i].title,
-                           books[i].author,
-                           books[i].available);
-                }
-            }
-            break;
-        }
-        case 2: {
-            system("clear || cls");
-            printHeader("BOOKS CURRENTLY ISSUED");
-            printf("%-5s %-30s %-8s %-12s %-12s\n", 
-                   "Book ID", "Title", "Member ID", "Issue Date", "Due Date");
-            printf("-----------------------------------------------------------------\n");
-            for(int i = 0; i < transaction_count; i++) {
-                if(transactions[i].returned == 0) {
-                    int book_index = findBookById(transactions[i].book_id);
-                    if(book_index != -1) {
-                        printf("%-5d %-30s %-8d %-12s %-12s\n",
-                               transactions[i].book_id,
-                               books[book_index].title,
-                               transactions[i].member_id,
-                               transactions[i].issue_date,
-                               transactions[i].due_date);
-                    }
-                }
+int libraryAvailableBooks(Book* results, int max_results) {
+    int count = 0;
+    for(int i = 0; i < book_count; i++) {
+        if(books[i].available > 0) {
+            if(count < max_results) {
+                results[count] = books[i];
             }
-            break;
+            count++;
         }
-        case 3: {
-            system("clear || cls");
-            printHeader("OVERDUE BOOKS");
-            char current_date[11];
-            getCurrentDate(current_date);
-            
-            printf("%-5s %-30s %-8s %-12s %-12s %-8s\n", 
-                   "Book ID", "Title", "Member ID", "Due Date", "Today", "Days Late");
-            printf("--------------------------------------------------------------------------\n");
-            
-            int overdue_count = 0;
-            for(int i = 0; i < transaction_count; i++) {
-                if(transactions[i].returned == 0) {
-                    int days_overdue = dateDifference(transactions[i].due_date, current_date);
-                    if(days_overdue > 0) {
-                        int book_index = findBookById(transactions[i].book_id);
-                        if(book_index != -1) {
-                            printf("%-5d %-30s %-8d %-12s %-12s %-8d\n",
-                                   transactions[i].book_id,
-                                   books[book_index].title,
-                                   transactions[i].member_id,
-                                   transactions[i].due_date,
-                                   current_date,
-                                   days_overdue);
-                            overdue_count++;
-                        }
-                    }
-                }
-            }
-            if(overdue_count == 0) {
-                printf("No overdue books!\n");
-            }
-            break;
+    }
+    return count;
+}
+
+int libraryOpenLoans(Transaction* results, int max_results, int overdue_only) {
+    int today = currentDay();
+    int count = 0;
+    for(int k = 0; k < open_loan_count; k++) {
+        Transaction* loan = &transactions[open_loans[k]];
+        if(overdue_only && parseDay(loan->due_date) >= today) {
+            continue;
         }
-        case 4: {
-            system("clear || cls");
-            printHeader("MEMBER REPORT");
-            printf("%-5s %-20s %-15s %-10s\n", "ID", "Name", "Books Issued", "Join Date");
-            printf("----------------------------------------------------\n");
-            for(int i = 0; i < member_count; i++) {
-                printf("%-5d %-20s %-15d %-10s\n",
-                       members[i].id,
-                       members[i].name,
-                       members[i].books_issued,
-                       members[i].join_date);
-            }
-            break;
+        if(count < max_results) {
+            results[count] = *loan;
         }
-        case 5: {
-            system("clear || cls");
-            printHeader("CATEGORY-WISE BOOKS");
-            
-            // Count books per category
-            char categories[100][30];
-            int category_count[100] = {0};
-            int unique_categories = 0;
-            
-            for(int i = 0; i < book_count; i++) {
-                int found = 0;
-                for(int j = 0; j < unique_categories; j++) {
-                    if(strcmp(categories[j], books[i].category) == 0) {
-                        category_count[j]++;
-                        found = 1;
-                        break;
-                    }
-                }
-                if(!found) {
-                    strcpy(categories[unique_categories], books[i].category);
-                    category_count[unique_categories] = 1;
-                    unique_categories++;
+        count++;
+    }
+    return count;
+}
+
+// Helper function to save and ship what an API call changed, and wait until
+// the writer has finished every save up to this one. saveData clears
+// checkpoint_failed to schedule a full rewrite, so failures are counted
+// across the call instead; LIB_OK means the change is on disk.
+LibraryStatus commitChanges() {
+    pthread_mutex_lock(&checkpoint_lock);
+    int failures = checkpoint_failures;
+    pthread_mutex_unlock(&checkpoint_lock);
+    if(!saveData()) {
+        return LIB_IO_ERROR;
+    }
+    shipPendingMutations();
+    pthread_mutex_lock(&checkpoint_lock);
+    while(checkpoint_completed < checkpoint_sequence) {
+        pthread_cond_wait(&checkpoint_done, &checkpoint_lock);
+    }
+    int failed = checkpoint_failures != failures;
+    pthread_mutex_unlock(&checkpoint_lock);
+    return failed ? LIB_IO_ERROR : LIB_OK;
+}
+
+// Helper function to test one book against a Search Book field
+int bookMatchesField(int field, const Book* book, const char* term) {
+    switch(field) {
+        case LIBRARY_SEARCH_ID:
+            return book->id == atoi(term);
+        case LIBRARY_SEARCH_ISBN:
+            return strstr(book->ISBN, term) != NULL;
+        case LIBRARY_SEARCH_TITLE:
+            return strstr(book->title, term) != NULL;
+        case LIBRARY_SEARCH_AUTHOR:
+            return strstr(book->author, term) != NULL;
+        case LIBRARY_SEARCH_CATEGORY:
+            return strstr(book->category, term) != NULL;
+    }
+    return 0;
+}
+
+// Helper function to test one member against a Search Member field
+int memberMatchesField(int field, const Member* member, const char* term) {
+    switch(field) {
+        case 1:
+            return member->id == atoi(term);
+        case 2:
+            return strstr(member->membership_id, term) != NULL;
+        case 3:
+            return strstr(member->name, term) != NULL;
+        case 4:
+            return strstr(member->email, term) != NULL;
+    }
+    return 0;
+}
+
+// Helper function to look up many ids in one merge pass over a table whose
+// records start with an int id. Ids are handed out in increasing order and
+// deletions keep the order, so the tables are sorted by id. indexes[i] gets
+// the slot of ids[i], or -1.
+void resolveIds(const int* ids, int count, const void* records, size_t record_size, int record_count, int* indexes) {
+    IdPosition* order = malloc(sizeof(IdPosition) * count);
+    if(order == NULL) {
+        for(int i = 0; i < count; i++) {
+            indexes[i] = -1;
+            for(int r = 0; r < record_count; r++) {
+                if(*(const int*)((const char*)records + (size_t)r * record_size) == ids[i]) {
+                    indexes[i] = r;
+                    break;
                 }
             }
-            
-            printf("%-20s %-10s\n", "Category", "Book Count");
-            printf("------------------------------\n");
-            for(int i = 0; i < unique_categories; i++) {
-                printf("%-20s %-10d\n", categories[i], category_count[i]);
-            }
-            break;
         }
-        default:
-            printf("Invalid choice!\n");
+        return;
+    }
+    for(int i = 0; i < count; i++) {
+        order[i].id = ids[i];
+        order[i].position = i;
+    }
+    qsort(order, count, sizeof(IdPosition), compareIdPosition);
+    
+    int r = 0;
+    for(int k = 0; k < count; k++) {
+        while(r < record_count && *(const int*)((const char*)records + (size_t)r * record_size) < order[k].id) {
+            r++;
+        }
+        int found = r < record_count && *(const int*)((const char*)records + (size_t)r * record_size) == order[k].id;
+        indexes[order[k].position] = found ? r : -1;
     }
+    free(order);
+}
+
+// Helper function to order batch ids ascending
+int compareIdPosition(const void* a, const void* b) {
+    int ia = ((const IdPosition*)a)->id;
+    int ib = ((const IdPosition*)b)->id;
+    return (ia > ib) - (ia < ib);
 }
 
-// Helper function to get current date
+// Helper function to copy a string into a fixed-size field, truncating
+void copyText(char* dest, const char* source, size_t size) {
+    size_t length = strnlen(source, size - 1);
+    memcpy(dest, source, length);
+    dest[length] = '\0';
+}
+
+// Helper function to get current date; a replay pins it to the trace's clock
 void getCurrentDate(char* date) {
-    time_t t = time(NULL);
+    time_t t = clock_override != 0 ? clock_override : time(NULL);
     struct tm tm = *localtime(&t);
     sprintf(date, "%04d-%02d-%02d", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
 }
@@ -1023,7 +5898,10 @@ int findBookById(int id) {
 }
 
 // Helper function to find book by ISBN
-int findBookByISBN(char* isbn) {
+int findBookByISBN(const char* isbn) {
+    if(isISBNValid(isbn) && !isbnFilterMayContain(isbn)) {
+        return -1;
+    }
     for(int i = 0; i < book_count; i++) {
         if(strcmp(books[i].ISBN, isbn) == 0) {
             return i;
@@ -1052,8 +5930,130 @@ int findMemberByMembershipId(char* membership_id) {
     return -1;
 }
 
+// Helper function to hash a valid ISBN: its 13 digits as a number, mixed
+// with the splitmix64 finalizer. The low bits pick the filter block and the
+// top 48 bits one bit per word.
+uint64_t isbnHash(const char* isbn) {
+    uint64_t h = 0;
+    for(int i = 0; i < 13; i++) {
+        h = h * 10 + (uint64_t)(isbn[i] - '0');
+    }
+    h += 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+// Helper function to add a valid ISBN to the filter
+void isbnFilterAdd(const char* isbn) {
+    uint64_t h = isbnHash(isbn);
+    uint64_t* block = isbn_filter[h & (isbn_filter_blocks - 1)];
+    for(int w = 0; w < ISBN_FILTER_WORDS; w++) {
+        block[w] |= 1ULL << ((h >> (16 + 6 * w)) & 63);
+    }
+}
+
+// Helper function to test a valid ISBN against the filter. 0 means no book
+// has it; 1 means one may.
+int isbnFilterMayContain(const char* isbn) {
+    uint64_t h = isbnHash(isbn);
+    const uint64_t* block = isbn_filter[h & (isbn_filter_blocks - 1)];
+    uint64_t missing = 0;
+    for(int w = 0; w < ISBN_FILTER_WORDS; w++) {
+        uint64_t bit = 1ULL << ((h >> (16 + 6 * w)) & 63);
+        missing |= bit & ~block[w];
+    }
+    return missing == 0;
+}
+
+// Helper function to get the filter blocks for keys ISBNs: enough for
+// ISBN_FILTER_BITS_PER_KEY bits each, rounded up to a power of two so a
+// block is picked by masking the hash
+int isbnFilterBlocksFor(int keys) {
+    int blocks = 1;
+    while(blocks < ISBN_FILTER_MAX_BLOCKS &&
+          (long)blocks * ISBN_FILTER_WORDS * 64 < (long)keys * ISBN_FILTER_BITS_PER_KEY) {
+        blocks *= 2;
+    }
+    return blocks;
+}
+
+// Helper function to rebuild the filter from books[], sized for them
+void rebuildIsbnFilter() {
+    isbn_filter_blocks = isbnFilterBlocksFor(book_count);
+    memset(isbn_filter, 0, sizeof(isbn_filter));
+    for(int i = 0; i < book_count; i++) {
+        if(isISBNValid(books[i].ISBN)) {
+            isbnFilterAdd(books[i].ISBN);
+        }
+    }
+}
+
+// Helper function to adopt books.bloom if it was written for the current
+// books.dat, at the size books.dat calls for. Returns 0 when the filter
+// must be rebuilt.
+int loadIsbnFilter() {
+    FILE *file = fopen(FILENAME_ISBN_FILTER, "rb");
+    if(file == NULL) {
+        return 0;
+    }
+    IsbnFilterHeader header;
+    uint32_t digest;
+    int ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == ISBN_FILTER_MAGIC &&
+             header.blocks == (uint32_t)isbnFilterBlocksFor(book_count) &&
+             fread(isbn_filter, sizeof(isbn_filter[0]), header.blocks, file) == header.blocks &&
+             crc32c(0, isbn_filter, sizeof(isbn_filter[0]) * header.blocks) == header.filter_crc &&
+             checksumFileDigest(FILENAME_BOOKS_CRC, &digest) && digest == header.books_digest;
+    fclose(file);
+    if(ok) {
+        isbn_filter_blocks = header.blocks;
+    }
+    return ok;
+}
+
+// Helper function to write books.bloom, a filter of blocks blocks, for the
+// books.dat just saved, via a temporary file renamed into place
+int writeIsbnFilter(const uint64_t* filter, int blocks) {
+    size_t size = sizeof(isbn_filter[0]) * blocks;
+    IsbnFilterHeader header = {ISBN_FILTER_MAGIC, blocks, 0, crc32c(0, filter, size)};
+    if(!checksumFileDigest(FILENAME_BOOKS_CRC, &header.books_digest)) {
+        return 0;
+    }
+    FILE *file = fopen(FILENAME_ISBN_FILTER ".tmp", "wb");
+    if(file == NULL) {
+        return 0;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(filter, size, 1, file) == 1;
+    ok = fflush(file) == 0 && fsync(fileno(file)) == 0 && ok;
+    fclose(file);
+    if(!ok || rename(FILENAME_ISBN_FILTER ".tmp", FILENAME_ISBN_FILTER) != 0) {
+        unlink(FILENAME_ISBN_FILTER ".tmp");
+        return 0;
+    }
+    return syncDirectory();
+}
+
+// Helper function to fingerprint a checksum sidecar: the CRC32C of the
+// whole file, which changes whenever its data file does
+int checksumFileDigest(const char* path, uint32_t* digest) {
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) {
+        return 0;
+    }
+    char buffer[4096];
+    size_t n;
+    *digest = 0;
+    while((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        *digest = crc32c(*digest, buffer, n);
+    }
+    int ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
 // Helper function to validate ISBN
-int isISBNValid(char* isbn) {
+int isISBNValid(const char* isbn) {
     if(strlen(isbn) != 13) {
         return 0;
     }
@@ -1072,9 +6072,204 @@ void clearInputBuffer() {
     while ((c = getchar()) != '\n' && c != EOF);
 }
 
+// Helper function to read a line in a command a replica serves. A replica
+// runs each command holding replica_lock and gives it up while waiting for
+// the user, so the tailer keeps applying changes; the command must re-read
+// the tables after the prompt.
+char* promptLine(char* buffer, int size) {
+    if(replica_mode) pthread_mutex_unlock(&replica_lock);
+    char* line = fgets(buffer, size, stdin);
+    if(replica_mode) pthread_mutex_lock(&replica_lock);
+    return line;
+}
+
+// Helper function to read a number in a command a replica serves, like
+// promptLine()
+int promptNumber(int* value) {
+    if(replica_mode) pthread_mutex_unlock(&replica_lock);
+    int read = scanf("%d", value);
+    if(replica_mode) pthread_mutex_lock(&replica_lock);
+    return read;
+}
+
 // Helper function to print header
 void printHeader(char* title) {
     printf("====================================\n");
     printf("    %s\n", title);
     printf("====================================\n");
 }
+
+// Helper function to refresh the case-folded title/author of one book
+void foldBookRecord(int index) {
+    int i;
+    for(i = 0; books[index].title[i] && i < MAX_TITLE - 1; i++) {
+        book_title_fold[index][i] = tolower((unsigned char)books[index].title[i]);
+    }
+    book_title_fold[index][i] = '\0';
+    
+    for(i = 0; books[index].author[i] && i < MAX_AUTHOR - 1; i++) {
+        book_author_fold[index][i] = tolower((unsigned char)books[index].author[i]);
+    }
+    book_author_fold[index][i] = '\0';
+}
+
+// Helper function to hash every q-gram of a folded string into its bucket;
+// counts postings when out is NULL, otherwise scatters them into out
+void forEachGramBucket(const char* text, int q, int record, int* last_seen, int* out, int* fill) {
+    int len = strlen(text);
+    for(int i = 0; i + q <= len; i++) {
+        uint32_t h = 0;
+        for(int j = 0; j < q; j++) {
+            h = h * 31 + (unsigned char)text[i + j];
+        }
+        h %= FUZZY_BUCKETS;
+        // A record is listed at most once per bucket
+        if(last_seen[h] == record) {
+            continue;
+        }
+        last_seen[h] = record;
+        if(out != NULL) {
+            out[fill[h]++] = record;
+        } else {
+            fill[h]++;
+        }
+    }
+}
+
+// Helper function to rebuild the n-gram indexes after books[] changed
+void rebuildFuzzyIndex() {
+    buildGramIndex(FUZZY_GRAM, fuzzy_bucket_start, fuzzy_postings);
+    buildGramIndex(FUZZY_SHORT_GRAM, fuzzy_bigram_start, fuzzy_bigram_postings);
+    fuzzy_index_dirty = 0;
+}
+
+// Helper function to build one q-gram index in CSR layout
+void buildGramIndex(int q, int* bucket_start, int* postings) {
+    static int last_seen[FUZZY_BUCKETS];
+    static int fill[FUZZY_BUCKETS];
+    
+    // Pass 1: count postings per bucket
+    memset(fill, 0, sizeof(fill));
+    for(int b = 0; b < FUZZY_BUCKETS; b++) last_seen[b] = -1;
+    for(int i = 0; i < book_count; i++) {
+        forEachGramBucket(book_title_fold[i], q, i, last_seen, NULL, fill);
+        forEachGramBucket(book_author_fold[i], q, i, last_seen, NULL, fill);
+    }
+    
+    bucket_start[0] = 0;
+    for(int b = 0; b < FUZZY_BUCKETS; b++) {
+        bucket_start[b + 1] = bucket_start[b] + fill[b];
+        fill[b] = bucket_start[b];
+    }
+    
+    // Pass 2: scatter record indexes into their buckets
+    for(int b = 0; b < FUZZY_BUCKETS; b++) last_seen[b] = -1;
+    for(int i = 0; i < book_count; i++) {
+        forEachGramBucket(book_title_fold[i], q, i, last_seen, postings, fill);
+        forEachGramBucket(book_author_fold[i], q, i, last_seen, postings, fill);
+    }
+}
+
+// Helper function for the bit-parallel (Myers) edit distance: returns the
+// fewest edits needed to match the pattern anywhere inside text
+int fuzzyDistance(const uint64_t* peq, int m, const char* text) {
+    uint64_t pv = ~0ULL;
+    uint64_t mv = 0;
+    uint64_t last = 1ULL << (m - 1);
+    int score = m;
+    int best = m;
+    
+    for(int i = 0; text[i]; i++) {
+        uint64_t eq = peq[(unsigned char)text[i]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        
+        if(ph & last) {
+            score++;
+        } else if(mh & last) {
+            score--;
+        }
+        
+        // Top row stays zero so a match may start at any text position
+        ph <<= 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        
+        if(score < best) {
+            best = score;
+        }
+    }
+    return best;
+}
+
+// CRC32C (Castagnoli), reflected polynomial
+#define CRC32C_POLY 0x82F63B78U
+
+uint32_t crc32c_table[256];
+pthread_once_t crc32c_table_once = PTHREAD_ONCE_INIT;
+
+void buildCrc32cTable() {
+    for(uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for(int k = 0; k < 8; k++) {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc32c_table[i] = crc;
+    }
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+// SSE4.2 crc32 instruction, eight bytes per step
+__attribute__((target("sse4.2")))
+uint32_t crc32cHardware(uint32_t crc, const unsigned char* p, size_t length) {
+    uint64_t c = crc;
+    while(length >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        c = _mm_crc32_u64(c, word);
+        p += 8;
+        length -= 8;
+    }
+    uint32_t c32 = (uint32_t)c;
+    while(length--) {
+        c32 = _mm_crc32_u8(c32, *p++);
+    }
+    return c32;
+}
+#elif defined(__ARM_FEATURE_CRC32)
+uint32_t crc32cHardware(uint32_t crc, const unsigned char* p, size_t length) {
+    while(length >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc = __crc32cd(crc, word);
+        p += 8;
+        length -= 8;
+    }
+    while(length--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+// Helper function to compute CRC32C, using the CPU's crc32 instruction
+// when available and a table-driven loop otherwise
+uint32_t crc32c(uint32_t crc, const void* data, size_t length) {
+    const unsigned char* p = data;
+    crc = ~crc;
+#if defined(__x86_64__) && defined(__GNUC__)
+    if(__builtin_cpu_supports("sse4.2")) {
+        return ~crc32cHardware(crc, p, length);
+    }
+#elif defined(__ARM_FEATURE_CRC32)
+    return ~crc32cHardware(crc, p, length);
+#endif
+    pthread_once(&crc32c_table_once, buildCrc32cTable);
+    while(length--) {
+        crc = crc32c_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
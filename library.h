@@ -0,0 +1,139 @@
+// Embeddable core of the Library Management System.
+//
+// These calls run the same catalogue, membership and circulation logic as
+// the menu in Library Management.c, without prompts or terminal output.
+// Inputs are structs, outcomes are LibraryStatus codes. Every mutating call
+// commits its changes with one save and returns once that save is on disk
+// (LIB_IO_ERROR if it, or a save queued before it, failed); the batch calls
+// commit once per batch.
+//
+// Build the core without its menu and link it into your program:
+//   gcc -c -DLIBRARY_NO_MAIN -pthread "Library Management.c" -o library.o
+// Data files are read from and written to the working directory.
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#define MAX_TITLE 100
+#define MAX_AUTHOR 50
+#define MAX_NAME 50
+#define MAX_ID 20
+
+typedef struct {
+    int id;
+    char title[MAX_TITLE];
+    char author[MAX_AUTHOR];
+    char ISBN[14];
+    int year;
+    int quantity;
+    int available;
+    char category[30];
+} Book;
+
+typedef struct {
+    int id;
+    char name[MAX_NAME];
+    char membership_id[MAX_ID];
+    char email[50];
+    char phone[15];
+    int books_issued;
+    char join_date[11];
+} Member;
+
+typedef struct {
+    int transaction_id;
+    int book_id;
+    int member_id;
+    char issue_date[11];
+    char due_date[11];
+    char return_date[11];
+    int returned;
+} Transaction;
+
+typedef enum {
+    LIB_OK = 0,
+    LIB_NOT_FOUND,          // no such book, member or open loan
+    LIB_INVALID,            // malformed input, e.g. an ISBN that is not 13 digits
+    LIB_DUPLICATE,          // the ISBN is already catalogued
+    LIB_FULL,               // table capacity reached
+    LIB_UNAVAILABLE,        // no copy on the shelf for this member
+    LIB_LIMIT_REACHED,      // member already has 5 books
+    LIB_IN_USE,             // copies or books still out on loan
+    LIB_IO_ERROR,           // a save failed
+    LIB_CORRUPT             // data files failed verification at open
+} LibraryStatus;
+
+// Book fields for add and update. On update, empty strings and negative
+// numbers keep the current value.
+typedef struct {
+    char title[MAX_TITLE];
+    char author[MAX_AUTHOR];
+    char isbn[14];
+    int year;
+    char category[30];
+    int quantity;
+} BookInput;
+
+// Member fields for add and update; on update, empty strings are kept
+typedef struct {
+    char name[MAX_NAME];
+    char email[50];
+    char phone[15];
+} MemberInput;
+
+// Field matched by librarySearchBooks; numbered like the Search Book menu
+typedef enum {
+    LIBRARY_SEARCH_ID = 1,      // exact id (term is the number)
+    LIBRARY_SEARCH_ISBN,
+    LIBRARY_SEARCH_TITLE,
+    LIBRARY_SEARCH_AUTHOR,
+    LIBRARY_SEARCH_CATEGORY     // text fields match on substring
+} LibrarySearchField;
+
+// One loan of a batch issue
+typedef struct {
+    int book_id;
+    int member_id;
+} LoanRequest;
+
+// Outcome of one entry of a batch
+typedef struct {
+    LibraryStatus status;
+    int transaction_id;
+    int fine_cents;         // returns only
+} LoanResult;
+
+// Load and verify the data files and start the background writer. On
+// LIB_CORRUPT, message explains which file is damaged.
+LibraryStatus libraryOpen(char* message, int message_size);
+// Wait for pending saves and stop the background writer
+LibraryStatus libraryClose(void);
+const char* libraryStatusText(LibraryStatus status);
+
+LibraryStatus libraryAddBook(const BookInput* input, int* book_id);
+LibraryStatus libraryUpdateBook(int book_id, const BookInput* input);
+LibraryStatus libraryDeleteBook(int book_id);
+LibraryStatus libraryGetBook(int book_id, Book* book);
+// Copies up to max_results matches into results; returns the match count
+int librarySearchBooks(LibrarySearchField field, const char* term, Book* results, int max_results);
+// Typo-tolerant search: books whose title or author contains term within
+// max_distance edits, ignoring case, best first. Copies up to max_results
+// books (and their distances, unless distances is NULL) and returns how
+// many; -1 for an empty term or a negative distance.
+int libraryFuzzySearch(const char* term, int max_distance, Book* results, int* distances, int max_results);
+
+LibraryStatus libraryAddMember(const MemberInput* input, int* member_id);
+LibraryStatus libraryUpdateMember(int member_id, const MemberInput* input);
+LibraryStatus libraryDeleteMember(int member_id);
+LibraryStatus libraryGetMember(int member_id, Member* member);
+
+LibraryStatus libraryIssueBook(int book_id, int member_id, int* transaction_id);
+LibraryStatus libraryReturnBook(int transaction_id, int* fine_cents);
+// Batches fill results[i] for entry i and return how many succeeded
+int libraryIssueBooks(const LoanRequest* requests, LoanResult* results, int count);
+int libraryReturnBooks(const int* transaction_ids, LoanResult* results, int count);
+
+// Reports: copy up to max rows and return the total row count
+int libraryAvailableBooks(Book* results, int max_results);
+int libraryOpenLoans(Transaction* results, int max_results, int overdue_only);
+
+#endif
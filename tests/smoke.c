@@ -0,0 +1,316 @@
+// Smoke driver for the embeddable core, built against library.h only.
+// tests/smoke.sh links it with library.o (compiled with -DLIBRARY_NO_MAIN)
+// and runs one phase per process, so each phase starts from what the
+// earlier ones left on disk. Prints "ok" or "FAIL" per check; the exit
+// status is the number of failures.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+#include "library.h"
+
+#define BOOKS 30
+#define MEMBERS 5
+
+int failures = 0;
+
+// Helper function to report one check
+void check(int passed, const char* what) {
+    printf("%s %s\n", passed ? "ok  " : "FAIL", what);
+    failures += !passed;
+}
+
+// Helper function to stop the run when setup fails; later checks would
+// only report the same fault again
+void require(int passed, const char* what) {
+    if(!passed) {
+        printf("FAIL setup: %s\n", what);
+        exit(1);
+    }
+}
+
+// Helper function to test whether a file exists in the working directory
+int fileExists(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+// Helper function to fill a BookInput for book number n (1-based)
+void makeBook(BookInput* input, int n) {
+    static const char* authors[] = {"Tolkien", "Rowling", "Asimov"};
+    memset(input, 0, sizeof(*input));
+    snprintf(input->title, sizeof(input->title), "Book %d", n);
+    snprintf(input->author, sizeof(input->author), "%s", authors[(n - 1) % 3]);
+    snprintf(input->isbn, sizeof(input->isbn), "978%010d", n);
+    input->year = 1990 + n;
+    snprintf(input->category, sizeof(input->category), "%s", n % 2 ? "Fantasy" : "SciFi");
+    input->quantity = 2;
+}
+
+// Helper function to fill a MemberInput for member number n (1-based)
+void makeMember(MemberInput* input, int n) {
+    memset(input, 0, sizeof(*input));
+    snprintf(input->name, sizeof(input->name), "Member %d", n);
+    snprintf(input->email, sizeof(input->email), "member%d@example.com", n);
+    snprintf(input->phone, sizeof(input->phone), "555000%d", n);
+}
+
+// Phase: fill the catalogue the other phases and the menu sessions run
+// against. Books are 1001-1030, members 2001-2005. Loans 3001 and 3002
+// take both copies of 1001; member 2003 borrows 1002-1006 as 3003-3007
+// and returns 3003 and 3004.
+void populate() {
+    BookInput book;
+    MemberInput member;
+    int id;
+    for(int n = 1; n <= BOOKS; n++) {
+        makeBook(&book, n);
+        require(libraryAddBook(&book, &id) == LIB_OK, "add books");
+    }
+    for(int n = 1; n <= MEMBERS; n++) {
+        makeMember(&member, n);
+        require(libraryAddMember(&member, &id) == LIB_OK, "add members");
+    }
+
+    LoanRequest requests[7] = {{1001, 2001}, {1001, 2002}, {1002, 2003}, {1003, 2003},
+                               {1004, 2003}, {1005, 2003}, {1006, 2003}};
+    LoanResult results[7];
+    require(libraryIssueBooks(requests, results, 7) == 7, "issue loans");
+    int returns[2] = {3003, 3004};
+    require(libraryReturnBooks(returns, results, 2) == 2, "return loans");
+}
+
+// Helper function to get the fewest edits that turn pattern into some
+// substring of text, ignoring case. A plain dynamic program, so it checks
+// the library's bit-parallel kernel rather than repeating it.
+int substringDistance(const char* pattern, const char* text) {
+    int m = strlen(pattern);
+    int column[65];
+    for(int i = 0; i <= m; i++) {
+        column[i] = i;
+    }
+    int best = column[m];
+    for(int j = 0; text[j]; j++) {
+        int diagonal = column[0];
+        column[0] = 0;      // a match may start anywhere in text
+        for(int i = 1; i <= m; i++) {
+            int above = column[i];
+            int cost = tolower((unsigned char)pattern[i - 1]) != tolower((unsigned char)text[j]);
+            int value = diagonal + cost;
+            if(above + 1 < value) value = above + 1;
+            if(column[i - 1] + 1 < value) value = column[i - 1] + 1;
+            column[i] = value;
+            diagonal = above;
+        }
+        if(column[m] < best) {
+            best = column[m];
+        }
+    }
+    return best;
+}
+
+// Phase: the pruned fuzzy search agrees with a full scan by a reference
+// edit distance
+void fuzzy() {
+    static const char* patterns[] = {"tolkin", "rowlng", "asimv", "book 3", "bok 12", "xyzzy", "fantasy"};
+    Book results[BOOKS + 1];
+    int distances[BOOKS + 1];
+    int mismatches = 0;
+    for(int k = 0; k <= 3; k++) {
+        for(size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+            int found = libraryFuzzySearch(patterns[p], k, results, distances, BOOKS + 1);
+            for(int i = 0; i < found; i++) {
+                int d = substringDistance(patterns[p], results[i].title);
+                int d_author = substringDistance(patterns[p], results[i].author);
+                mismatches += distances[i] != (d_author < d ? d_author : d);
+            }
+
+            int expected = 0;
+            Book book;
+            for(int id = 1001; id < 1001 + BOOKS; id++) {
+                if(libraryGetBook(id, &book) != LIB_OK) continue;
+                int d = substringDistance(patterns[p], book.title);
+                int d_author = substringDistance(patterns[p], book.author);
+                expected += (d_author < d ? d_author : d) <= k;
+            }
+            mismatches += found != expected;
+        }
+    }
+    check(mismatches == 0, "fuzzy search matches a full scan");
+
+    check(libraryFuzzySearch("Tolkein", 2, results, distances, 1) == 1 &&
+          strcmp(results[0].author, "Tolkien") == 0, "fuzzy search finds a misspelt author");
+    check(libraryFuzzySearch("", 2, results, distances, 5) == -1, "empty fuzzy pattern rejected");
+}
+
+// Phase: a save whose journal commits but cannot be applied keeps the
+// journal; books.dat is swapped for a directory meanwhile
+void journal() {
+    check(!fileExists("library.journal"), "journal removed once applied");
+    rename("books.dat", "books.keep");
+    mkdir("books.dat", 0755);
+    BookInput book;
+    makeBook(&book, BOOKS + 1);
+    int id;
+    check(libraryAddBook(&book, &id) == LIB_IO_ERROR, "failed save reported");
+    check(fileExists("library.journal"), "unapplied journal kept");
+}
+
+// Phase: after the data file is back, the kept journal is applied at open
+void journalApplied() {
+    Book book;
+    check(libraryGetBook(1000 + BOOKS + 1, &book) == LIB_OK, "kept journal applied at open");
+    check(!fileExists("library.journal"), "journal removed after replay");
+}
+
+// Phase: a restart reads only the open-loan working set, yet finds every
+// open loan
+void openLoans() {
+    check(fileExists("openloans.dat"), "open-loan list written");
+    Transaction loans[8];
+    int count = libraryOpenLoans(loans, 8, 0);
+    check(count == 5 && loans[0].transaction_id == 3001 && loans[4].transaction_id == 3007,
+          "open loans found after restart");
+    Book book;
+    check(libraryGetBook(1001, &book) == LIB_OK && book.available == 0, "availability kept");
+}
+
+// Phase: ISBN lookups and duplicate checks behind the ISBN filter
+void isbn() {
+    check(fileExists("books.bloom"), "ISBN filter written");
+    Book found[4];
+    check(librarySearchBooks(LIBRARY_SEARCH_ISBN, "9780000000005", found, 4) == 1 && found[0].id == 1005,
+          "ISBN lookup finds a catalogued book");
+    check(librarySearchBooks(LIBRARY_SEARCH_ISBN, "9789999999999", found, 4) == 0,
+          "ISBN lookup misses an unknown book");
+    BookInput book;
+    makeBook(&book, 7);
+    int id;
+    check(libraryAddBook(&book, &id) == LIB_DUPLICATE, "duplicate ISBN rejected");
+}
+
+// Phase: the ISBN filter grows with the catalogue and still finds every
+// book. books.bloom is a 16-byte header and 64-byte blocks of 16 bits per
+// ISBN, rounded up to a power of two.
+void isbnGrowth() {
+    struct stat st;
+    check(stat("books.bloom", &st) == 0 && st.st_size == 16 + 64, "ISBN filter sized for 30 books");
+    BookInput book;
+    int id;
+    for(int n = BOOKS + 1; n <= 100; n++) {
+        makeBook(&book, n);
+        require(libraryAddBook(&book, &id) == LIB_OK, "add books");
+    }
+    int missed = 0;
+    Book found[4];
+    for(int n = 1; n <= 100; n++) {
+        makeBook(&book, n);
+        missed += librarySearchBooks(LIBRARY_SEARCH_ISBN, book.isbn, found, 4) != 1;
+    }
+    check(missed == 0, "grown ISBN filter finds every book");
+    check(stat("books.bloom", &st) == 0 && st.st_size == 16 + 4 * 64, "ISBN filter resized for 100 books");
+}
+
+// Phase: the library API on an empty library of its own
+void api() {
+    BookInput book;
+    MemberInput member;
+    int id;
+    makeBook(&book, 1);
+    check(libraryAddBook(&book, &id) == LIB_OK && id == 1001, "add book");
+    makeBook(&book, 2);
+    book.quantity = 1;
+    check(libraryAddBook(&book, &id) == LIB_OK && id == 1002, "add single copy");
+    makeBook(&book, 3);
+    strcpy(book.isbn, "12345");
+    check(libraryAddBook(&book, &id) == LIB_INVALID, "malformed ISBN rejected");
+
+    BookInput change;
+    memset(&change, 0, sizeof(change));
+    change.year = -1;
+    change.quantity = -1;
+    strcpy(change.title, "Renamed");
+    Book stored;
+    check(libraryUpdateBook(1001, &change) == LIB_OK && libraryGetBook(1001, &stored) == LIB_OK &&
+          strcmp(stored.title, "Renamed") == 0 && stored.quantity == 2, "update keeps unset fields");
+    check(libraryGetBook(1999, &stored) == LIB_NOT_FOUND, "unknown book");
+
+    for(int n = 1; n <= 2; n++) {
+        makeMember(&member, n);
+        check(libraryAddMember(&member, &id) == LIB_OK && id == 2000 + n, "add member");
+    }
+
+    int transaction_id;
+    check(libraryIssueBook(1002, 2001, &transaction_id) == LIB_OK && transaction_id == 3001, "issue book");
+    check(libraryIssueBook(1002, 2002, &transaction_id) == LIB_UNAVAILABLE, "no copy left");
+    check(libraryIssueBook(1001, 2999, &transaction_id) == LIB_NOT_FOUND, "unknown member");
+    check(libraryDeleteBook(1002) == LIB_IN_USE, "book on loan not deleted");
+
+    // Four more loans reach the limit of five; the sixth entry is refused
+    for(int n = 3; n <= 7; n++) {
+        makeBook(&book, n);
+        book.quantity = 1;
+        libraryAddBook(&book, &id);
+    }
+    LoanRequest requests[5] = {{1003, 2001}, {1004, 2001}, {1005, 2001}, {1006, 2001}, {1007, 2001}};
+    LoanResult results[5];
+    check(libraryIssueBooks(requests, results, 5) == 4 && results[3].transaction_id == 3005 &&
+          results[4].status == LIB_LIMIT_REACHED, "batch issue stops at the limit");
+
+    int returns[3] = {3001, 3002, 3001};
+    check(libraryReturnBooks(returns, results, 3) == 2 && results[0].fine_cents == 0 &&
+          results[2].status == LIB_NOT_FOUND, "batch return");
+    int fine_cents;
+    check(libraryReturnBook(3001, &fine_cents) == LIB_NOT_FOUND, "second return rejected");
+
+    check(libraryOpenLoans(NULL, 0, 0) == 3, "open loans counted");
+    check(libraryAvailableBooks(NULL, 0) == 4, "available books counted");
+    check(strcmp(libraryStatusText(LIB_LIMIT_REACHED), "member issue limit reached") == 0, "status text");
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s PHASE [ARG]\n", argv[0]);
+        return 1;
+    }
+
+    // The open itself is under test: it must refuse, naming argv[2]
+    if(strcmp(argv[1], "refused") == 0) {
+        char message[1024];
+        LibraryStatus status = libraryOpen(message, sizeof(message));
+        check(status == LIB_CORRUPT && argc > 2 && strstr(message, argv[2]) != NULL, "damaged data refused");
+        if(status == LIB_OK) {
+            libraryClose();
+        }
+        return failures;
+    }
+
+    char message[1024];
+    if(libraryOpen(message, sizeof(message)) != LIB_OK) {
+        printf("FAIL libraryOpen: %s", message);
+        return 1;
+    }
+    if(strcmp(argv[1], "populate") == 0) {
+        populate();
+    } else if(strcmp(argv[1], "fuzzy") == 0) {
+        fuzzy();
+    } else if(strcmp(argv[1], "journal") == 0) {
+        journal();
+    } else if(strcmp(argv[1], "journal-applied") == 0) {
+        journalApplied();
+    } else if(strcmp(argv[1], "open-loans") == 0) {
+        openLoans();
+    } else if(strcmp(argv[1], "isbn") == 0) {
+        isbn();
+    } else if(strcmp(argv[1], "isbn-growth") == 0) {
+        isbnGrowth();
+    } else if(strcmp(argv[1], "api") == 0) {
+        api();
+    } else {
+        fprintf(stderr, "Unknown phase %s!\n", argv[1]);
+        failures++;
+    }
+    libraryClose();
+    return failures;
+}
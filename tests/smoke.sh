@@ -0,0 +1,202 @@
+#!/bin/sh
+# Smoke test for the Library Management System.
+#
+# Builds the core with -DLIBRARY_NO_MAIN and links tests/smoke.c against it
+# through library.h, builds the menu program, then runs both in a scratch
+# directory: the driver covers the API, persistence and recovery, and
+# scripted menu sessions cover the interactive features. Prints "ok" or
+# "FAIL" per check and exits non-zero if any check failed.
+#
+#   sh tests/smoke.sh            (CC and CFLAGS may be overridden)
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:-"-std=c11 -Wall -Wextra -O2"}
+WORK=$(mktemp -d "${TMPDIR:-/tmp}/library-smoke.XXXXXX") || exit 1
+trap 'rm -rf "$WORK"' EXIT
+failures=0
+
+# The core starts threads, so every build line needs -pthread
+$CC $CFLAGS -pthread -DLIBRARY_NO_MAIN -c "$ROOT/Library Management.c" -o "$WORK/library.o" || exit 1
+$CC $CFLAGS -pthread -I"$ROOT" "$ROOT/tests/smoke.c" "$WORK/library.o" -o "$WORK/smoke" || exit 1
+$CC $CFLAGS -pthread "$ROOT/Library Management.c" -o "$WORK/library" || exit 1
+
+# driver PHASE [ARG]: run one phase of tests/smoke.c in the current directory
+driver() {
+    "$WORK/smoke" "$@"
+    failures=$((failures + $?))
+}
+
+# menu INPUT [OPTIONS]: feed keystrokes to the menu program; INPUT must end
+# by choosing 0 (Exit), as the menu loops at end of input
+menu() {
+    input=$1
+    shift
+    printf "$input" | TERM=dumb timeout 30 "$WORK/library" "$@" > "$WORK/menu.out" 2>&1
+}
+
+# expect WHAT PATTERN: check the last menu session printed PATTERN
+expect() {
+    if grep -q -- "$2" "$WORK/menu.out"; then
+        echo "ok   $1"
+    else
+        echo "FAIL $1"
+        failures=$((failures + 1))
+    fi
+}
+
+# present WHAT FILE...: check every FILE exists in the current directory
+present() {
+    what=$1
+    shift
+    for file in "$@"; do
+        if [ ! -e "$file" ]; then
+            echo "FAIL $what ($file missing)"
+            failures=$((failures + 1))
+            return
+        fi
+    done
+    echo "ok   $what"
+}
+
+# scratch NAME: continue in a copy of the shared data, for sessions that
+# change it
+scratch() {
+    rm -rf "$WORK/$1" && cp -R "$WORK/data" "$WORK/$1" && cd "$WORK/$1" || exit 1
+}
+
+# Shared data: 30 books, 5 members and 7 loans, 2 of them returned
+mkdir "$WORK/data" && cd "$WORK/data" || exit 1
+TODAY=$(date +%Y-%m-%d)
+driver populate || exit 1
+
+# Fuzzy search
+driver fuzzy
+
+# Query engine: a limited query stops early
+menu '16\n1\nyear>0 limit=5\n\n0\n'
+expect "query stops at its limit" "5 record(s) shown, 5 of 30 scanned"
+
+# Journaled writes: a committed journal that cannot be applied is kept,
+# blocks the next open, and is applied once the data file is back
+scratch journal
+driver journal
+driver refused library.journal
+rmdir books.dat && mv books.keep books.dat
+driver journal-applied
+cd "$WORK/data" || exit 1
+
+# Background checkpoints: a queued save is on disk for the next session
+scratch checkpoint
+menu '6\nWalk In\nwalkin@example.com\n5550100\n\n15\n\n0\n'
+expect "save queued to the writer" "Save #[0-9]* queued"
+menu '8\n3\nWalk In\n\n0\n'
+expect "checkpoint persisted" "Walk In"
+cd "$WORK/data" || exit 1
+
+# Checksums: sidecars are written and catch a damaged table at open
+present "checksum sidecars written" books.crc members.crc transactions.crc
+scratch damaged
+printf 'X' | dd of=members.dat bs=1 seek=40 conv=notrunc 2>/dev/null
+driver refused members.dat
+cd "$WORK/data" || exit 1
+
+# Loan history
+menu '17\n1\n2003\n\n0\n'
+expect "member loan history" "5 loan(s)"
+
+# Date-range reports
+menu "14\n6\n2024-02-30\n$TODAY\n\n14\n7\n$TODAY\n$TODAY\n\n0\n"
+expect "impossible date rejected" "Invalid date range!"
+expect "monthly circulation" "^$(date +%Y-%m) *7 "
+
+# Fine accrual: nothing is overdue yet
+menu '14\n9\n\n0\n'
+expect "fine accrual" "Overdue loans: 0"
+
+# Most-borrowed titles and authors
+menu '14\n11\n1\n3\n\n0\n'
+expect "most borrowed title" "^1 *Book 1 "
+expect "most borrowed author" "^1 *Tolkien *3 "
+
+# Holds: a duplicate is refused and a return readies the next hold
+scratch holds
+menu '18\n1\n1001\n2004\n\n18\n1\n1001\n2004\n\n12\n3001\n\n0\n'
+expect "hold placed" "Hold placed! Hold ID: 4001"
+expect "duplicate hold rejected" "already has a hold on this book"
+expect "return readies the hold" "Copy set aside for Member 2004 (hold 4001)"
+cd "$WORK/data" || exit 1
+
+# Cross-branch search, skipping a damaged branch
+mkdir -p "$WORK/site/branches/north" "$WORK/site/branches/south" || exit 1
+cp "$WORK/data"/*.dat "$WORK/data"/*.crc "$WORK/site/branches/north"
+cp "$WORK/data"/*.dat "$WORK/data"/*.crc "$WORK/site/branches/south"
+cd "$WORK/site" || exit 1
+menu '3\n7\ntitle~"Book 30"\n\n0\n'
+expect "north branch searched" "^north .*Book 30"
+expect "south branch searched" "^south .*Book 30"
+printf 'X' | dd of=branches/south/books.dat bs=1 seek=40 conv=notrunc 2>/dev/null
+menu '3\n7\ntitle~"Book 30"\n\n0\n'
+expect "damaged branch skipped" "^south .*skipped"
+cd "$WORK/data" || exit 1
+
+# Read replica fed by the shipping log
+scratch ship
+menu '0\n' --ship
+(sleep 1; printf '3\n3\nBook 30\n\n0\n') | TERM=dumb timeout 30 "$WORK/library" --replica > "$WORK/menu.out" 2>&1
+expect "replica serves shipped books" "Book 30"
+
+# ...and keeps applying them while a command waits for input: the member
+# is added after the replica is already at the search prompt
+(sleep 1; printf '6\nWalk In\nwalkin@example.com\n5550100\n\n'; sleep 3; printf '0\n') |
+    TERM=dumb timeout 30 "$WORK/library" --ship > /dev/null 2>&1 &
+(sleep 0.5; printf '8\n3\n'; sleep 2.5; printf 'Walk In\n\n0\n') | TERM=dumb timeout 30 "$WORK/library" --replica > "$WORK/menu.out" 2>&1
+wait
+expect "replica applies changes during a prompt" "Walk In"
+cd "$WORK/data" || exit 1
+
+# Lazy history: a restart starts from the open-loan list
+driver open-loans
+
+# ISBN filter
+driver isbn
+scratch isbn
+driver isbn-growth
+cd "$WORK/data" || exit 1
+
+# Report cache: an unchanged report is served from the cache
+menu '14\n1\n\n14\n1\n\n14\n0\n\n0\n'
+expect "report cache hit" "Report cache: 1 hits"
+
+# Library API on an empty library
+mkdir "$WORK/api" && cd "$WORK/api" || exit 1
+driver api
+
+# The menu reports why an add failed
+menu '1\nBad Copy\nNobody\n9780000000099\n2000\nFantasy\n-1\n\n0\n'
+expect "failed add reported" "Cannot add the book: invalid input!"
+cd "$WORK/data" || exit 1
+
+# Paginated browsing with a bad jump id
+menu '2\nj\nabc\n\n\n0\n'
+expect "paginated view" "Rows 1-20 of 30"
+expect "bad jump id rejected" "Invalid ID!"
+
+# Trace a session and replay it against the snapshot it took
+scratch trace
+menu '11\n1008\n2005\n\n18\n1\n1001\n2005\n\n3\n6\ntolkin\n\n\n\n11\n1999\n\n12\n3999\n\n0\n' --trace session.trace
+TERM=dumb timeout 60 "$WORK/library" --replay session.trace --speed max > "$WORK/menu.out" 2>&1
+status=$?
+expect "not-found attempts traced" "Replaying 5 operation(s)"
+expect "trace replays without differences" "Outcomes differing from the recording: 0"
+if [ $status -ne 0 ]; then
+    echo "FAIL replay exit status $status"
+    failures=$((failures + 1))
+fi
+cd "$WORK/data" || exit 1
+
+if [ $failures -ne 0 ]; then
+    echo "$failures check(s) failed"
+    exit 1
+fi
+echo "All checks passed"